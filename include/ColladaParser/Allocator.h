@@ -0,0 +1,212 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef COLLADA_PARSER_ALLOCATOR_H_
+#define COLLADA_PARSER_ALLOCATOR_H_
+
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
+
+#include <ColladaParser/Config.h>
+
+
+namespace ColladaParser
+{
+
+	/**
+	 * Allocator interface.
+	 * 
+	 * An allocator is made current on the threads parsing a document and
+	 * every element, and the arrays inside it, is allocated from it. The
+	 * allocator must outlive everything allocated from it.
+	 */
+	class COLLADA_PARSER_API Allocator
+	{
+	public:
+		virtual ~Allocator () {}
+		
+		
+		/* safe to call concurrently */
+		virtual void* allocate (size_t size, size_t alignment) = 0;
+		virtual void deallocate (void* data, size_t size) = 0;
+		
+		/* called once everything allocated has been freed, so memory
+		 * which wasn't given back one piece at a time can be */
+		virtual void release () {}
+		
+		
+		/* the allocator current on this thread, or the heap when no
+		 * allocator is current */
+		static Allocator* getCurrent ();
+		static Allocator* getHeap ();
+		
+		
+		/* makes an allocator current on this thread for its lifetime */
+		class COLLADA_PARSER_API Scope
+		{
+		public:
+			explicit Scope (Allocator* allocator);
+			~Scope ();
+			
+		private:
+			Allocator* mPrevious;
+		};
+	};
+	
+	
+	
+	/**
+	 * Arena allocator.
+	 * 
+	 * Small pieces are carved from large blocks and pieces given back are
+	 * kept on a free list for their size, so elements dropped while opening
+	 * are reused rather than lost. Larger pieces such as arrays come from
+	 * the heap and are freed as soon as they are given back. Releasing
+	 * frees the blocks at once. Elements are still destroyed one by one
+	 * before that, so teardown stays per object, it only saves returning
+	 * each piece to the heap.
+	 */
+	class COLLADA_PARSER_API ArenaAllocator : public Allocator
+	{
+	public:
+		explicit ArenaAllocator (size_t blockSize = 64 * 1024);
+		~ArenaAllocator ();
+		
+		
+		void* allocate (size_t size, size_t alignment);
+		void deallocate (void* data, size_t size);
+		void release ();
+		
+		/* bytes held in blocks and large pieces */
+		size_t getSize () const;
+		
+		
+	private:
+		/* small pieces are rounded up to a multiple of the grain */
+		static const size_t GRAIN = 16;
+		static const size_t SMALL_LIMIT = 1024;
+		static const size_t SIZE_CLASSES = SMALL_LIMIT / GRAIN;
+		
+		struct FreePiece
+		{
+			FreePiece* next;
+		};
+		
+		struct LargePiece
+		{
+			char* block;
+			size_t size;
+		};
+		
+		mutable std::mutex mMutex;
+		std::vector<char*> mBlocks;
+		
+		size_t mBlockSize;
+		size_t mSize;
+		
+		/* free space of the last block */
+		char* mNext;
+		char* mEnd;
+		
+		/* pieces given back, by size class */
+		FreePiece* mFree[SIZE_CLASSES];
+		
+		/* heap pieces by the address handed out */
+		std::unordered_map<void*, LargePiece> mLarge;
+		
+		
+		void* allocateLarge (size_t size, size_t alignment);
+		
+		/* not copyable */
+		ArenaAllocator (const ArenaAllocator&);
+		ArenaAllocator& operator= (const ArenaAllocator&);
+	};
+	
+	
+	
+	/**
+	 * Base of the parsed objects, which are allocated from the current
+	 * allocator and given back to the one they came from.
+	 */
+	class COLLADA_PARSER_API Allocated
+	{
+	public:
+		static void* operator new (size_t size);
+		static void operator delete (void* data);
+	};
+	
+	
+	
+	/**
+	 * Standard container allocator for the arrays inside parsed objects.
+	 * Uses the allocator current when the container was made.
+	 */
+	template <typename T>
+	class ContainerAllocator
+	{
+	public:
+		typedef T value_type;
+		
+		typedef std::true_type propagate_on_container_copy_assignment;
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+		
+		
+		ContainerAllocator () : mAllocator(Allocator::getCurrent()) {}
+		
+		template <typename U>
+		ContainerAllocator (const ContainerAllocator<U>& other) : mAllocator(other.getAllocator()) {}
+		
+		
+		T* allocate (size_t count)
+		{
+			return static_cast<T*> (mAllocator->allocate (count * sizeof (T), alignof (T)));
+		}
+		
+		void deallocate (T* data, size_t count)
+		{
+			mAllocator->deallocate (data, count * sizeof (T));
+		}
+		
+		
+		Allocator* getAllocator() const { return mAllocator; }
+		
+		template <typename U>
+		bool operator== (const ContainerAllocator<U>& other) const { return mAllocator == other.getAllocator(); }
+		
+		template <typename U>
+		bool operator!= (const ContainerAllocator<U>& other) const { return mAllocator != other.getAllocator(); }
+		
+		
+	private:
+		Allocator* mAllocator;
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_ALLOCATOR_H_ */
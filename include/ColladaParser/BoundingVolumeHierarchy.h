@@ -0,0 +1,198 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef COLLADA_PARSER_BOUNDING_VOLUME_HIERARCHY_H_
+#define COLLADA_PARSER_BOUNDING_VOLUME_HIERARCHY_H_
+
+
+#include <vector>
+#include <atomic>
+
+#include <ColladaParser/Config.h>
+#include <ColladaParser/Types.h>
+#include <ColladaParser/Node.h>
+
+
+namespace ColladaParser
+{
+
+	/* forward declarations */
+	class ThreadPool; class TransformEvaluator;
+	
+	
+	/**
+	 * A ray to cast into the hierarchy.
+	 */
+	struct COLLADA_PARSER_API Ray
+	{
+		Vector origin;
+		Vector direction;
+		float length;
+	};
+	
+	
+	/**
+	 * The nearest instance bounds hit by a ray.
+	 * The instance is -1 when nothing was hit.
+	 */
+	struct COLLADA_PARSER_API RayHit
+	{
+		int instance;
+		float distance;
+	};
+	
+	
+	/**
+	 * A plane given by its normal and distance from the origin. Points
+	 * with dot(normal, point) + distance >= 0 are inside.
+	 */
+	struct COLLADA_PARSER_API Plane
+	{
+		Vector normal;
+		float distance;
+	};
+	
+	
+	/**
+	 * A view frustum given by its six inward facing planes.
+	 */
+	struct COLLADA_PARSER_API Frustum
+	{
+		Plane planes[6];
+	};
+	
+	
+	
+	/**
+	 * Bounding volume hierarchy.
+	 * 
+	 * Places every geometry instance of an evaluated scene by its world
+	 * space bounds and organises them in a binned surface area heuristic
+	 * tree. Queries return indices into the instance list which stay
+	 * valid across refits.
+	 */
+	class COLLADA_PARSER_API BoundingVolumeHierarchy
+	{
+	public:
+		/**
+		 * A geometry instance placed in the world.
+		 */
+		struct COLLADA_PARSER_API Instance
+		{
+			const Node* node;
+			const GeometryInstance* geometry;
+			
+			/* index of the node in the transform evaluator */
+			size_t transform;
+			
+			Bounds local;
+			Bounds world;
+		};
+		
+		
+		/**
+		 * Constructor.
+		 * Gathers the geometry instances and builds the tree.
+		 * @param transforms The evaluated scene transforms.
+		 * @param threads The amount of threads to use, zero for all cores.
+		 */
+		BoundingVolumeHierarchy (const TransformEvaluator* transforms, unsigned int threads = 0);
+		
+		/**
+		 * Destructor.
+		 */
+		~BoundingVolumeHierarchy ();
+		
+		
+		/**
+		 * Rebuild the tree from scratch.
+		 */
+		void build ();
+		
+		/**
+		 * Recompute the world bounds after the transforms were updated
+		 * while keeping the tree topology.
+		 */
+		void refit ();
+		
+		
+		/**
+		 * The placed geometry instances.
+		 */
+		const std::vector<Instance>& getInstances() const { return mInstances; }
+		
+		/**
+		 * The bounds of the whole scene.
+		 */
+		Bounds getBounds() const;
+		
+		
+		/**
+		 * Find the nearest instance bounds hit by each ray.
+		 */
+		void intersect (const std::vector<Ray>& rays, std::vector<RayHit>& hits) const;
+		
+		/**
+		 * Find the instances overlapping the frustum.
+		 */
+		void intersect (const Frustum& frustum, std::vector<size_t>& instances) const;
+		
+		/**
+		 * Find the instances overlapping each frustum.
+		 */
+		void intersect (const std::vector<Frustum>& frusta, std::vector< std::vector<size_t> >& instances) const;
+		
+		
+	private:
+		/* tree node. internal nodes have two consecutive children and
+		 * leaves reference a range of the instance order */
+		struct Volume
+		{
+			Bounds bounds;
+			unsigned int first;
+			unsigned int count;
+		};
+		
+		
+		const TransformEvaluator* mTransforms;
+		
+		std::vector<Instance> mInstances;
+		std::vector<unsigned int> mOrder;
+		std::vector<Volume> mVolumes;
+		std::atomic<unsigned int> mVolumeCount;
+		
+		ThreadPool* mPool;
+		
+		
+		void gather ();
+		void placeInstances ();
+		void split (unsigned int volume, unsigned int begin, unsigned int end, unsigned int depth);
+		
+		RayHit cast (const Ray& ray) const;
+		void cull (const Frustum& frustum, std::vector<size_t>& instances) const;
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_BOUNDING_VOLUME_HIERARCHY_H_ */
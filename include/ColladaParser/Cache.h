@@ -0,0 +1,153 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+
+#ifndef COLLADA_PARSER_CACHE_H_
+#define COLLADA_PARSER_CACHE_H_
+
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <unordered_map>
+#include <stdint.h>
+
+#include <ColladaParser/Config.h>
+#include <ColladaParser/Hash.h>
+
+
+namespace ColladaParser
+{
+
+	class MappedFile;
+	
+	
+	/**
+	 * Binary cache file header.
+	 * The cache is only meant for the machine that wrote it, values are
+	 * stored in native byte order and layout.
+	 */
+	struct COLLADA_PARSER_LOCAL CacheHeader
+	{
+		enum { VERSION = 2 };
+		enum Flags { DEDUPLICATED = 1, PRESERVED_WHITE_SPACE = 2 };
+		
+		char magic[8];
+		uint32_t version;
+		uint32_t flags;
+		
+		/* the XML file the cache was written from */
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		Hash sourceHash;
+		
+		/* string table */
+		uint64_t strings;
+		uint64_t stringCount;
+	};
+	
+	
+	
+	/**
+	 * Writes a binary cache file.
+	 * Strings are written as indices into a table at the end of the file
+	 * and arrays are aligned to 16 bytes so they can be used in place.
+	 */
+	class COLLADA_PARSER_LOCAL CacheWriter
+	{
+	public:
+		explicit CacheWriter (const std::string& file);
+		~CacheWriter ();
+		
+		
+		void write (const void* data, size_t size);
+		
+		template <typename T>
+		void write (const T& value) { write (&value, sizeof (T)); }
+		
+		void writeString (const std::string& text);
+		
+		/* an array written twice is only stored once */
+		void writeArray (const void* data, size_t size);
+		
+		/* write the string table and header and replace the cache file */
+		void finish (CacheHeader& header);
+		
+		
+	private:
+		std::string mFile;
+		std::string mTemporary;
+		std::ofstream mStream;
+		uint64_t mPosition;
+		
+		std::unordered_map<std::string, uint32_t> mStringIndex;
+		std::vector<const std::string*> mStrings;
+		
+		std::unordered_map<const void*, uint64_t> mArrays;
+		
+		void pad (uint64_t position);
+	};
+	
+	
+	
+	/**
+	 * Reads a binary cache file mapped into memory.
+	 * Arrays are returned as pointers into the mapping, every read is
+	 * bounds checked and throws on a truncated file.
+	 */
+	class COLLADA_PARSER_LOCAL CacheReader
+	{
+	public:
+		explicit CacheReader (const std::shared_ptr<MappedFile>& file);
+		
+		
+		const CacheHeader& getHeader() const { return mHeader; }
+		const std::shared_ptr<MappedFile>& getFile() const { return mFile; }
+		
+		
+		void read (void* data, size_t size);
+		
+		template <typename T>
+		T read () { T value; read (&value, sizeof (T)); return value; }
+		
+		const std::string& readString ();
+		
+		/* pointer into the mapping, size is in bytes */
+		const void* readArray (size_t& size);
+		
+		
+	private:
+		std::shared_ptr<MappedFile> mFile;
+		CacheHeader mHeader;
+		uint64_t mPosition;
+		
+		std::vector<std::string> mStrings;
+		
+		void check (uint64_t position, uint64_t size) const;
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_CACHE_H_ */
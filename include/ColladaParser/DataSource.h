@@ -29,6 +29,8 @@ THE SOFTWARE.
 #include <string>
 
 #include <ColladaParser/Config.h>
+#include <ColladaParser/Allocator.h>
+#include <ColladaParser/Hash.h>
 
 
 namespace ColladaParser
@@ -55,7 +57,7 @@ namespace ColladaParser
 	 * A DataSource is the interface to all data elements which need to
 	 * access a particular kind of data from a Collada document.
 	 */
-	class COLLADA_PARSER_API DataSource
+	class COLLADA_PARSER_API DataSource : public Allocated
 	{
 	public:
 		/**
@@ -84,6 +86,12 @@ namespace ColladaParser
 		};
 		
 		
+		/**
+		 * Sources and inputs are deleted through their DataSource.
+		 */
+		virtual ~DataSource () {}
+		
+		
 		/**
 		 * The amount of entries within the DataSource.
 		 */
@@ -100,6 +108,18 @@ namespace ColladaParser
 		 */
 		virtual const Accessor &getAccessor() = 0;
 		
+		/**
+		 * Get the hash of the data and its layout. Element ids are not
+		 * part of the hash so identical data under different ids match.
+		 */
+		virtual Hash getHash() = 0;
+		
+		/**
+		 * Compare the data and its layout with another DataSource, which
+		 * confirms a hash match.
+		 */
+		virtual bool isEqual (DataSource* source) = 0;
+		
 		
 		/**
 		 * Get the total size of the data in the DataSource.
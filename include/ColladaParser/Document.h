@@ -26,13 +26,22 @@ THE SOFTWARE.
 
 #include <string>
 #include <vector>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
 
 #include <ColladaParser/Config.h>
+#include <ColladaParser/Allocator.h>
 
 #include <ColladaParser/Material.h>
 #include <ColladaParser/Effect.h>
 #include <ColladaParser/Geometry.h>
 #include <ColladaParser/VisualScene.h>
+#include <ColladaParser/LoadFilter.h>
+#include <ColladaParser/Memory.h>
 
 
 
@@ -43,6 +52,12 @@ namespace ticpp { class Element; }
 namespace ColladaParser
 {
 
+	class MappedFile;
+	class CacheReader;
+	class CacheWriter;
+	class ProgressMonitor;
+	
+	
 	/* list types */
 	typedef std::vector<Material*>    MaterialList;
 	typedef std::vector<Effect*>      EffectList;
@@ -51,6 +66,58 @@ namespace ColladaParser
 	
 	
 	
+	/* the element addressed by a scoped identifier */
+	struct COLLADA_PARSER_API SIDTarget
+	{
+		Node*             node;
+		Transform*        transform;
+		GeometryInstance* geometry;
+		
+		SIDTarget () : node(0), transform(0), geometry(0) {}
+	};
+	
+	
+	
+	/* how far an open has come */
+	struct COLLADA_PARSER_API OpenProgress
+	{
+		size_t bytes;
+		size_t totalBytes;
+		
+		/* library elements parsed */
+		size_t elements;
+		size_t totalElements;
+		
+		OpenProgress () : bytes(0), totalBytes(0), elements(0), totalElements(0) {}
+	};
+	
+	typedef std::function<void (const OpenProgress& progress)> ProgressCallback;
+	
+	
+	/* thrown by an open that was cancelled */
+	class COLLADA_PARSER_API OpenCancelled : public std::runtime_error
+	{
+	public:
+		OpenCancelled () : std::runtime_error ("Open cancelled") {}
+	};
+	
+	
+	
+	/* what content deduplication collapsed while opening */
+	struct COLLADA_PARSER_API DeduplicationStats
+	{
+		size_t geometries;
+		size_t effects;
+		size_t sources;
+		
+		/* approximate bytes of data released */
+		size_t bytesSaved;
+		
+		DeduplicationStats () : geometries(0), effects(0), sources(0), bytesSaved(0) {}
+	};
+	
+	
+	
 	class COLLADA_PARSER_API Document
 	{
 	public:
@@ -59,21 +126,238 @@ namespace ColladaParser
 		
 		bool open ();
 		
+		/* open on a background thread. the document is parsed element by
+		 * element so progress is reported as it goes and cancel stops it
+		 * from within the parsing loops. the future throws OpenCancelled
+		 * when cancelled, the document is left empty. the document must
+		 * outlive the future */
+		std::future<bool> openAsync ();
+		
+		/* stop the running open. every open and openAsync clears the
+		 * request when it starts, so it only affects the current one */
+		void cancel () { mCancelled.store (true); }
+		bool isCancelled() const { return mCancelled.load(); }
+		
+		/* called as elements are parsed, from the parsing threads but
+		 * never concurrently */
+		void setProgressCallback (const ProgressCallback& callback) { mProgress = callback; }
+		
+		
+		/* only index the library elements when opening and parse each
+		 * one on first access. lazy loading is ignored when duplicates
+		 * are collapsed since that needs every element, and writing a
+		 * cache parses every element once opened. geometry instances
+		 * resolve their geometry and materials on first access. the
+		 * getters may be called from several threads, the first access
+		 * is serialised */
+		void setLazy (bool lazy) { mLazy = lazy; }
+		
+		/* only load the library elements and nodes the filter accepts.
+		 * rejected elements are unknown to the document afterwards */
+		void setFilter (const LoadFilter& filter) { mFilter = filter; }
+		
+		/* threads used to parse the library elements when opening, the
+		 * lists keep document order. one parses on the calling thread
+		 * and zero uses the hardware concurrency */
+		void setThreadCount (unsigned int threads) { mThreads = threads; }
+		
+		/* collapse geometries and effects with identical content into
+		 * one shared instance and share identical source arrays. the
+		 * ids of removed duplicates resolve to the kept instance.
+		 * content with matching 128 bit hashes is compared in full before
+		 * it is collapsed */
+		void setDeduplicate (bool deduplicate) { mDeduplicate = deduplicate; }
+		
+		/* collapse runs of white space in element text to single spaces
+		 * while parsing. on by default, turning it off keeps the text
+		 * exactly as written */
+		void setCondenseWhiteSpace (bool condense) { mCondenseWhiteSpace = condense; }
+		
+		const DeduplicationStats& getDeduplicationStats() const { return mDeduplicationStats; }
 		
-		const MaterialList&    getMaterials    () const { return mMaterials; }
-		const EffectList&      getEffects      () const { return mEffects; }
-		const GeometryList&    getGeometries   () const { return mGeometries; }
-		const VisualSceneList& getVisualScenes () const { return mVisualScenes; }
+		/* ids, names and references of every element share one copy
+		 * of each distinct string */
+		StringStats getStringStats() const { return mStrings->getStats(); }
+		
+		/* memory held by the document for each category and library,
+		 * and the most held at once since it was opened */
+		MemoryStats getMemoryStats() const;
+		
+		/* fail opening or loading an element with MemoryBudgetExceeded
+		 * when the document would hold more than the given bytes. sizes
+		 * given by count attributes are checked before anything is read
+		 * so oversized documents fail early. an open that fails leaves
+		 * the document empty. zero is unlimited */
+		void setMemoryBudget (size_t bytes) { mMemory.setBudget (bytes); }
+		
+		/* keep source and index arrays of at least the given bytes off
+		 * the heap, mapped from temporary files in the directory so the
+		 * system can page them out, or mapped anonymously without one.
+		 * mapped arrays don't count against the budget. zero keeps
+		 * every array on the heap */
+		void setOutOfCore (size_t bytes, const std::string& directory = std::string());
+		
+		/* allocate every element and the arrays inside it from the given
+		 * allocator, which is released once the document is closed if
+		 * the document is its only owner. an allocator shared with other
+		 * documents or kept by the caller is never released by the
+		 * document. frees whatever was opened before. documents use an
+		 * ArenaAllocator unless told otherwise. closing still destroys
+		 * the elements one by one, and node and transform strings and
+		 * the lists handed out come from the heap */
+		void setAllocator (const std::shared_ptr<Allocator>& allocator);
+		const std::shared_ptr<Allocator>& getAllocator() const { return mAllocator; }
+		
+		/* keep a binary copy of the parsed document in the given file.
+		 * open reads the copy while the file it came from is unchanged
+		 * and parses the XML and writes a new copy otherwise, which parses
+		 * lazy documents in full. filtered documents are not cached */
+		void setCache (const std::string& file) { mCache = file; }
+		
+		/* write every element to a binary cache file */
+		void saveCache (const std::string& file) const;
+		
+		
+		const MaterialList&    getMaterials    () const;
+		const EffectList&      getEffects      () const;
+		const GeometryList&    getGeometries   () const;
+		const VisualSceneList& getVisualScenes () const;
+		
+		
+		/* lookup by '#id' url or plain id, null when not found */
+		Material*    getMaterial    (const std::string& url) const;
+		Effect*      getEffect      (const std::string& url) const;
+		Geometry*    getGeometry    (const std::string& url) const;
+		VisualScene* getVisualScene (const std::string& url) const;
+		Node*        getNode        (const std::string& url) const;
+		
+		
+		/* resolve a scoped identifier address such as 'node/sid/sid'.
+		 * the first part names an element id, every following part
+		 * names the nearest scoped identifier below the previous one */
+		SIDTarget resolveSID (const std::string& address) const;
+		
+		/* resolve a scoped identifier path below the given node */
+		SIDTarget resolveSID (const Node* scope, const std::string& path) const;
 		
 		
 	private:
+		/* the elements of a library. in lazy mode each element is only
+		 * indexed by its byte range and parsed on first access */
+		template <typename T>
+		struct Library
+		{
+			struct Fragment
+			{
+				size_t begin;
+				size_t end;
+				T* object;
+				bool published;
+				
+				/* filtered text replacing the byte range */
+				std::string text;
+			};
+			
+			std::vector<T*> objects;
+			std::unordered_map<std::string, T*> index;
+			
+			std::vector<Fragment> fragments;
+			std::unordered_map<std::string, size_t> pending;
+			bool complete;
+			
+			Library () : complete(true) {}
+		};
+		
+		
+		/* scoped identifiers are keyed by their owning element */
+		typedef std::pair<const void*, std::string> SIDKey;
+		
+		struct SIDHash
+		{
+			size_t operator() (const SIDKey& key) const
+			{
+				return std::hash<const void*>() (key.first) ^ (std::hash<std::string>() (key.second) * 31);
+			}
+		};
+		
+		
 		std::string mFile;
+		std::string mCache;
+		
+		bool mLazy;
+		bool mDeduplicate;
+		bool mCondenseWhiteSpace;
+		LoadFilter mFilter;
+		unsigned int mThreads;
+		DeduplicationStats mDeduplicationStats;
+		
+		std::atomic<bool> mCancelled;
+		ProgressCallback mProgress;
+		
+		/* made current wherever elements are constructed */
+		std::shared_ptr<StringPool> mStrings;
+		std::shared_ptr<Allocator> mAllocator;
+		
+		/* memory held while parsing */
+		mutable MemoryTracker mMemory;
+		
+		/* document text kept for lazy parsing */
+		MappedFile* mSource;
+		
+		/* held while the getters parse and link elements on access */
+		mutable std::recursive_mutex mLoadMutex;
+		
+		mutable Library<Material>    mMaterials;
+		mutable Library<Effect>      mEffects;
+		mutable Library<Geometry>    mGeometries;
+		mutable Library<VisualScene> mVisualScenes;
+		
+		/* node index */
+		mutable std::unordered_map<std::string, Node*> mNodeIndex;
+		
+		/* scoped identifier index */
+		mutable std::unordered_map<SIDKey, SIDTarget, SIDHash> mSIDIndex;
+		
+		
+		template <typename T> void add (Library<T>& library, T* object);
+		template <typename T> void add (Library<T>& library, size_t begin, size_t end, const std::string& id, const std::string& text);
+		
+		template <typename T> T* parse (const typename Library<T>::Fragment& fragment) const;
+		template <typename T> T* load (Library<T>& library, size_t fragment) const;
+		template <typename T> void loadAll (Library<T>& library) const;
+		template <typename T> T* find (Library<T>& library, const std::string& url) const;
+		template <typename T> void clear (Library<T>& library);
+		void release ();
+		
+		template <typename T> void readLibrary (CacheReader& reader, Library<T>& library);
+		template <typename T> void writeLibrary (CacheWriter& writer, const Library<T>& library) const;
+		
+		/* resolve the references of a newly parsed element */
+		void attach (Material* material) const;
+		void attach (Effect*) const {}
+		void attach (Geometry*) const {}
+		void attach (VisualScene* scene) const;
+		
+		void indexNode (const void* owner, Node* node) const;
+		
+		/* lazy instances are resolved on first access */
+		friend struct GeometryInstance;
+		void resolve (const GeometryInstance* instance) const;
+		void deduplicate ();
+		void link ();
+		
+		SIDTarget findSID (const void* scope, const NodeList& nodes, const std::string& sid) const;
+		SIDTarget resolvePath (const void* scope, const NodeList* nodes, const std::string& path) const;
+		
+		bool loadCache ();
+		Hash hashFile () const;
 		
-		MaterialList    mMaterials;
-		EffectList      mEffects;
-		GeometryList    mGeometries;
-		VisualSceneList mVisualScenes;
+		uint32_t getCacheFlags () const;
 		
+		bool openFile (bool incremental);
+		void parseFile (bool incremental);
+		void scan ();
+		void parseParallel ();
 		
 		void parseMaterials    (ticpp::Element* element);
 		void parseEffects      (ticpp::Element* element);
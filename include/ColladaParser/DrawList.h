@@ -0,0 +1,102 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef COLLADA_PARSER_DRAW_LIST_H_
+#define COLLADA_PARSER_DRAW_LIST_H_
+
+
+#include <vector>
+
+#include <ColladaParser/Config.h>
+#include <ColladaParser/Document.h>
+
+
+namespace ColladaParser
+{
+
+	/* forward declarations */
+	class TransformEvaluator;
+	
+	
+	/**
+	 * Draw list.
+	 * 
+	 * Resolves the material bindings of every geometry instance in an
+	 * evaluated scene once and emits the primitives sorted by effect,
+	 * material, geometry and primitive. Consecutive draws of the same
+	 * primitive are merged into a single instanced run.
+	 */
+	class COLLADA_PARSER_API DrawList
+	{
+	public:
+		/**
+		 * An instanced run of a single primitive.
+		 * The effect and material are null when the primitive material
+		 * symbol isn't bound.
+		 */
+		struct COLLADA_PARSER_API Draw
+		{
+			const Effect*    effect;
+			const Material*  material;
+			const Geometry*  geometry;
+			const Primitive* primitive;
+			
+			/* range of world matrix indices in getTransforms() */
+			size_t first;
+			size_t count;
+		};
+		
+		
+		/**
+		 * Constructor.
+		 * Builds the draw list of the evaluated scene.
+		 * @param document The document the scene belongs to.
+		 * @param transforms The evaluated scene transforms.
+		 */
+		DrawList (const Document* document, const TransformEvaluator* transforms);
+		
+		
+		/**
+		 * The sorted and merged draws.
+		 */
+		const std::vector<Draw>& getDraws() const { return mDraws; }
+		
+		/**
+		 * The world matrix indices of every draw in the transform
+		 * evaluator, ordered by draw.
+		 */
+		const std::vector<size_t>& getTransforms() const { return mTransforms; }
+		
+		
+	private:
+		std::vector<Draw> mDraws;
+		std::vector<size_t> mTransforms;
+		
+		
+		void build (const Document* document, const TransformEvaluator* transforms);
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_DRAW_LIST_H_ */
@@ -26,9 +26,12 @@ THE SOFTWARE.
 
 #include <vector>
 #include <string>
+#include <memory>
 
 #include <ColladaParser/Config.h>
+#include <ColladaParser/Allocator.h>
 #include <ColladaParser/Profile.h>
+#include <ColladaParser/StringPool.h>
 
 
 /* forward declarations */
@@ -42,25 +45,47 @@ namespace ColladaParser
 	
 	
 	
-	class COLLADA_PARSER_API Effect
+	class COLLADA_PARSER_API Effect : public Allocated
 	{
 	public:
 		Effect (ticpp::Element* element);
+		Effect (CacheReader& reader);
 		~Effect ();
 		
 		
-		std::string getID() { return mID; }
-		std::string getName() { return mName; }
+		const std::string& getID() const { return mID; }
+		const std::string& getName() const { return mName; }
 		
-		const ProfileCommonList& getCommonProfiles() { return mCommonProfiles; }
+		const ProfileCommonList& getCommonProfiles() const { return mCommonProfiles; }
+		
+		/* hash of the profiles and parameters. effects with equal hashes
+		 * render the same */
+		const Hash& getHash() const { return mHash; }
+		
+		/* compare everything hashed, hashes can collide */
+		bool isEqual (const Effect& effect) const;
+		
+		
+		void write (CacheWriter& writer) const;
 		
 		
 	private:
+		/* holds the strings of the effect */
+		std::shared_ptr<StringPool> mStrings;
+		
 		/* effect properties */
-		std::string mID;
-		std::string mName;
+		InternedString mID;
+		InternedString mName;
 		
 		ProfileCommonList mCommonProfiles;
+		Hash mHash;
+		
+		/* newparam elements as written, the profiles may sample them */
+		std::string mParams;
+		
+		
+		/* free the profiles */
+		void release ();
 		
 		
 		/* parsing methods */
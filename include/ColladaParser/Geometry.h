@@ -25,8 +25,10 @@ THE SOFTWARE.
 
 
 #include <vector>
+#include <memory>
 
 #include <ColladaParser/Config.h>
+#include <ColladaParser/Allocator.h>
 #include <ColladaParser/Source.h>
 #include <ColladaParser/Input.h>
 
@@ -39,7 +41,7 @@ namespace ColladaParser
 {
 
 	/* primitive geometry data */
-	class COLLADA_PARSER_API Primitive
+	class COLLADA_PARSER_API Primitive : public Allocated
 	{
 	public:
 		/* primitive type */
@@ -56,6 +58,7 @@ namespace ColladaParser
 		
 		
 		Primitive (ticpp::Element* element, SourceMap* sources);
+		Primitive (CacheReader& reader, SourceMap* sources);
 		~Primitive ();
 		
 		
@@ -74,15 +77,35 @@ namespace ColladaParser
 		int getIndexCount() const { return mIndices->getCount(); }
 		
 		
+		/* hash of the index data and the data behind each input */
+		const Hash& getHash() const { return mHash; }
+		
+		/* compare everything hashed */
+		bool isEqual (const Primitive& primitive) const;
+		
+		/* size in bytes of the index data */
+		size_t getDataSize() const { return mIndices->getDataSize(); }
+		
+		
+		void write (CacheWriter& writer) const;
+		
+		
 	private:
+		friend class MemoryCounter;
+		
 		/* primitive properties */
-		std::string mName;
-		std::string mMaterial;
+		InternedString mName;
+		InternedString mMaterial;
 		
 		std::vector<Input*> mInputs;
 		Indices* mIndices;
 		
 		SourceMap* mSources;
+		Hash mHash;
+		
+		
+		/* free inputs and indices */
+		void release ();
 		
 		
 		/* parsing methods */
@@ -93,10 +116,11 @@ namespace ColladaParser
 	
 	
 	
-	class COLLADA_PARSER_API Geometry
+	class COLLADA_PARSER_API Geometry : public Allocated
 	{
 	public:
 		explicit Geometry (ticpp::Element* element);
+		explicit Geometry (CacheReader& reader);
 		~Geometry ();
 		
 		
@@ -106,13 +130,43 @@ namespace ColladaParser
 		const std::vector<Primitive*>& getPrimitives() const { return mPrimitives; }
 		
 		
+		/* axis aligned bounds of the vertex positions. this is computed
+		 * on every call so cache the result when it is used frequently */
+		Bounds computeBounds() const;
+		
+		
+		/* content hash of the sources and primitives. geometries with
+		 * equal hashes hold the same mesh under different ids */
+		const Hash& getHash() const { return mHash; }
+		
+		/* compare everything hashed, hashes can collide */
+		bool isEqual (const Geometry& geometry) const;
+		
+		/* size in bytes of the source and index data */
+		size_t getDataSize() const;
+		
+		const SourceMap& getSources() const { return mSources; }
+		
+		
+		void write (CacheWriter& writer) const;
+		
+		
 	private:
+		/* holds the strings of the geometry and its parts */
+		std::shared_ptr<StringPool> mStrings;
+		
 		/* source properties */
-		std::string mID;
-		std::string mName;
+		InternedString mID;
+		InternedString mName;
 		
 		SourceMap mSources;
+		DataSource* mPositions;
 		std::vector<Primitive*> mPrimitives;
+		Hash mHash;
+		
+		
+		/* free sources and primitives */
+		void release ();
 		
 		
 		/* parsing methods */
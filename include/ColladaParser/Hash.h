@@ -0,0 +1,93 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef COLLADA_PARSER_HASH_H_
+#define COLLADA_PARSER_HASH_H_
+
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+#include <ColladaParser/Config.h>
+
+
+namespace ColladaParser
+{
+
+	/**
+	 * A 128 bit content hash.
+	 */
+	struct COLLADA_PARSER_API Hash
+	{
+		uint64_t low;
+		uint64_t high;
+		
+		Hash () : low(0), high(0) {}
+		
+		bool operator== (const Hash& hash) const { return low == hash.low && high == hash.high; }
+		bool operator!= (const Hash& hash) const { return !(*this == hash); }
+		
+		/* hash functor for unordered containers */
+		struct Key
+		{
+			size_t operator() (const Hash& hash) const { return (size_t) hash.low; }
+		};
+	};
+	
+	
+	
+	/**
+	 * Hash a block of memory with a 128 bit MurmurHash3 seeded by the
+	 * given hash.
+	 */
+	COLLADA_PARSER_API Hash computeHash (const void* data, size_t size, const Hash& seed = Hash());
+	
+	
+	
+	/**
+	 * Incremental hasher.
+	 * Each added block is chained onto the hash of everything before it.
+	 */
+	class COLLADA_PARSER_API Hasher
+	{
+	public:
+		void add (const void* data, size_t size) { mHash = computeHash (data, size, mHash); }
+		void add (const std::string& text) { add (text.data(), text.size()); }
+		void add (const Hash& hash) { add (&hash, sizeof (hash)); }
+		
+		void add (int value)      { add (&value, sizeof (value)); }
+		void add (unsigned value) { add (&value, sizeof (value)); }
+		void add (float value)    { add (&value, sizeof (value)); }
+		
+		const Hash& getHash() const { return mHash; }
+		
+		
+	private:
+		Hash mHash;
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_HASH_H_ */
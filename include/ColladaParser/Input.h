@@ -24,9 +24,13 @@ THE SOFTWARE.
 #define COLLADA_PARSER_COLLADA_INPUT_H_
 
 
+#include <memory>
+
 #include <ColladaParser/Config.h>
+#include <ColladaParser/Allocator.h>
 #include <ColladaParser/Types.h>
 #include <ColladaParser/DataSource.h>
+#include <ColladaParser/StringPool.h>
 
 
 /* forward declarations */
@@ -35,6 +39,11 @@ namespace ticpp { class Element; }
 
 namespace ColladaParser
 {
+	class CacheReader;
+	class CacheWriter;
+	class MappedFile;
+	class MappedBuffer;
+	
 
 	enum COLLADA_PARSER_API InputSemantic
 	{
@@ -67,22 +76,25 @@ namespace ColladaParser
 	
 	
 	
-	class COLLADA_PARSER_API Indices
+	class COLLADA_PARSER_API Indices : public Allocated
 	{
 	public:
-		Indices () { mStride = 1; }
+		Indices () : mData(0), mSize(0), mCapacity(0), mStride(1) {}
 		~Indices () {}
 		
 		
 		void setStride (int stride) { mStride = stride; }
 		
-		int getCount() { return mIndices.size() / mStride; }
+		int getCount() { return mSize / mStride; }
 		
 		
 		/* add index to list */
 		void add (int index)
 		{
-			mIndices.push_back (index);
+			if (mSize == mCapacity)
+				reserve (mCapacity < 16 ? 16 : mCapacity * 2);
+			
+			mData[mSize++] = index;
 		}
 		
 		/* get index from list */
@@ -90,17 +102,56 @@ namespace ColladaParser
 		{
 			index *= mStride;
 			index += offset;
-			return mIndices[index];
+			return mData[index];
+		}
+		
+		
+		/* large lists are kept out of core when the parse allows it */
+		void reserve (size_t size);
+		
+		
+		/* size in bytes of the index data */
+		size_t getDataSize() const { return mSize * sizeof (int); }
+		
+		/* hash of the index data and stride */
+		Hash getHash() const
+		{
+			Hasher hasher;
+			
+			if (mSize > 0)
+				hasher.add (mData, getDataSize());
+			
+			hasher.add (mStride);
+			return hasher.getHash();
 		}
 		
+		/* compare the index data and stride */
+		bool isEqual (const Indices& indices) const;
 		
-		void reserve (int size) { mIndices.reserve (size); }
+		
+		void read  (CacheReader& reader);
+		void write (CacheWriter& writer) const;
 		
 		
 	private:
-		/* each offset has its own index map */
-		std::vector<int> mIndices;
+		friend class MemoryCounter;
+		
+		/* each offset has its own index map, held in either the vector,
+		 * a mapped buffer or read only in place from a cache file */
+		int* mData;
+		size_t mSize;
+		size_t mCapacity;
+		
+		std::vector<int, ContainerAllocator<int> > mIndices;
+		std::shared_ptr<MappedBuffer> mBuffer;
+		std::shared_ptr<MappedFile> mMapping;
+		
 		int mStride;
+		
+		
+		/* not copyable */
+		Indices (const Indices&);
+		Indices& operator= (const Indices&);
 	};
 	
 	
@@ -110,6 +161,7 @@ namespace ColladaParser
 	{
 	public:
 		Input (ticpp::Element *element, SourceMap &sources);
+		Input (CacheReader& reader, SourceMap &sources);
 		~Input ();
 		
 		
@@ -122,11 +174,19 @@ namespace ColladaParser
 		
 		void getData (int index, std::vector<float> &data);
 		
+		/* hash of the semantic, offset and source data */
+		Hash getHash();
+		bool isEqual (DataSource* source);
+		
+		
+		void write (CacheWriter& writer) const;
+		
 		
 	private:
 		InputSemantic mSemantic;
 		unsigned int mOffset;
 		
+		InternedString mURL;
 		DataSource *mSource;
 		Indices *mIndices;
 		
@@ -142,6 +202,7 @@ namespace ColladaParser
 		
 		/* parsing methods */
 		void parse (ticpp::Element *element, SourceMap &sources);
+		void attach (SourceMap &sources);
 		
 		InputSemantic parseSemantic (const std::string &semantic);
 	};
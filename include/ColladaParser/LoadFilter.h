@@ -0,0 +1,127 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef COLLADA_PARSER_LOAD_FILTER_H_
+#define COLLADA_PARSER_LOAD_FILTER_H_
+
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_set>
+
+#include <ColladaParser/Config.h>
+#include <ColladaParser/Scanner.h>
+
+
+namespace ColladaParser
+{
+
+	/**
+	 * The libraries a LoadFilter can select elements from.
+	 */
+	enum COLLADA_PARSER_API LibraryType
+	{
+		LIBRARY_MATERIALS,
+		LIBRARY_EFFECTS,
+		LIBRARY_GEOMETRIES,
+		LIBRARY_VISUAL_SCENES,
+		
+		LIBRARY_COUNT
+	};
+	
+	
+	
+	/**
+	 * Selects which library elements are loaded. Rejected elements are
+	 * skipped over by the tag scanner so their content is never parsed.
+	 * An empty filter accepts everything.
+	 */
+	class COLLADA_PARSER_API LoadFilter
+	{
+	public:
+		typedef std::function<bool (LibraryType type, const std::string& id)> Predicate;
+		
+		
+		LoadFilter ();
+		
+		
+		/**
+		 * Only load elements the predicate accepts.
+		 */
+		void setPredicate (const Predicate& predicate) { mPredicate = predicate; }
+		
+		/**
+		 * Only load the listed ids of a library. Libraries without any
+		 * listed id load all of their elements.
+		 */
+		void addID (LibraryType type, const std::string& id);
+		
+		/**
+		 * Only load nodes on one of the listed layers. Nodes without a
+		 * layer are always loaded and a rejected node takes its children
+		 * with it. Visual scenes left without a node are not loaded.
+		 */
+		void addLayer (const std::string& layer);
+		
+		
+		/**
+		 * Whether the filter accepts every element.
+		 */
+		bool isEmpty() const;
+		
+		/**
+		 * Whether an element of a library should be loaded.
+		 */
+		bool accepts (LibraryType type, const std::string& id) const;
+		
+		/**
+		 * Whether a node with the given space separated layer attribute
+		 * should be loaded.
+		 */
+		bool acceptsLayers (const std::string& layers) const;
+		
+		
+	private:
+		friend class Document;
+		friend class Reader;
+		
+		Predicate mPredicate;
+		std::unordered_set<std::string> mIDs[LIBRARY_COUNT];
+		std::unordered_set<std::string> mLayers;
+		
+		
+		/* text of a visual scene without its rejected nodes, empty when
+		 * no node is left */
+		std::string filterScene (const Scanner& scanner, const Scanner::Element& scene) const;
+		
+		/* byte ranges of the rejected nodes below an element */
+		typedef std::vector<std::pair<size_t, size_t> > RangeList;
+		
+		void findRejected (const Scanner& scanner, const Scanner::Element& element, RangeList& rejected) const;
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_LOAD_FILTER_H_ */
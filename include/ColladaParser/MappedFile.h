@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef COLLADA_PARSER_MAPPED_FILE_H_
+#define COLLADA_PARSER_MAPPED_FILE_H_
+
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include <ColladaParser/Config.h>
+
+
+namespace ColladaParser
+{
+
+	/**
+	 * Read only view of a whole file. The file is memory mapped where
+	 * the platform supports it, otherwise it is read into a buffer.
+	 */
+	class COLLADA_PARSER_LOCAL MappedFile
+	{
+	public:
+		explicit MappedFile (const std::string& file);
+		~MappedFile ();
+		
+		
+		const char* getData() const { return mData; }
+		size_t getSize() const { return mSize; }
+		
+		
+	private:
+		const char* mData;
+		size_t mSize;
+		
+		bool mMapped;
+		std::vector<char> mBuffer;
+		
+		
+		/* not copyable */
+		MappedFile (const MappedFile&);
+		MappedFile& operator= (const MappedFile&);
+	};
+	
+	
+	
+	/**
+	 * Writable memory kept off the heap so the system can page it out.
+	 * It is mapped from a temporary file, which is removed straight
+	 * away, or anonymously when no directory is given. Falls back to a
+	 * buffer where mapping isn't supported.
+	 */
+	class COLLADA_PARSER_LOCAL MappedBuffer
+	{
+	public:
+		MappedBuffer (size_t size, const std::string& directory);
+		~MappedBuffer ();
+		
+		
+		void* getData() const { return mData; }
+		size_t getSize() const { return mSize; }
+		
+		
+	private:
+		void* mData;
+		size_t mSize;
+		
+		bool mMapped;
+		std::vector<char> mBuffer;
+		
+		
+		/* not copyable */
+		MappedBuffer (const MappedBuffer&);
+		MappedBuffer& operator= (const MappedBuffer&);
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_MAPPED_FILE_H_ */
@@ -25,8 +25,11 @@ THE SOFTWARE.
 
 
 #include <string>
+#include <memory>
 
 #include <ColladaParser/Config.h>
+#include <ColladaParser/Allocator.h>
+#include <ColladaParser/StringPool.h>
 
 
 /* forward declarations */
@@ -36,19 +39,35 @@ namespace ticpp { class Element; }
 namespace ColladaParser
 {
 
-	class COLLADA_PARSER_API Material
+	/* forward declarations */
+	class Effect;
+	class CacheReader;
+	class CacheWriter;
+	
+	
+	class COLLADA_PARSER_API Material : public Allocated
 	{
+		/* resolves the effect instance */
+		friend class Document;
+		
+		
 	public:
 		/* an effect instance structure */
 		struct Effect
 		{
-			std::string sid;
-			std::string name;
-			std::string url;
+			InternedString sid;
+			InternedString name;
+			InternedString url;
+			
+			/* resolved by the document */
+			ColladaParser::Effect* effect;
+			
+			Effect () : effect(0) {}
 		};
 		
 		
 		Material (ticpp::Element* element);
+		Material (CacheReader& reader);
 		~Material ();
 		
 		
@@ -58,10 +77,16 @@ namespace ColladaParser
 		const Effect& getEffect() const { return mEffect; }
 		
 		
+		void write (CacheWriter& writer) const;
+		
+		
 	private:
+		/* holds the strings of the material */
+		std::shared_ptr<StringPool> mStrings;
+		
 		/* material properties */
-		std::string mID;
-		std::string mName;
+		InternedString mID;
+		InternedString mName;
 		
 		Effect mEffect;
 		
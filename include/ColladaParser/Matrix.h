@@ -0,0 +1,92 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef COLLADA_PARSER_MATRIX_H_
+#define COLLADA_PARSER_MATRIX_H_
+
+
+#include <ColladaParser/Config.h>
+#include <ColladaParser/Types.h>
+
+
+namespace ColladaParser
+{
+
+	/**
+	 * A 4x4 transformation matrix.
+	 * 
+	 * The matrix is stored in column-major order so that each column can be
+	 * loaded directly into a SIMD register. Note that Collada itself writes
+	 * '<matrix>' elements in row-major order, Transform takes care of the
+	 * conversion when parsing.
+	 */
+	struct COLLADA_PARSER_API Matrix
+	{
+		alignas(16) float m[16];
+		
+		
+		/**
+		 * Access the element at the given row and column.
+		 */
+		float& operator() (int row, int col) { return m[col * 4 + row]; }
+		float  operator() (int row, int col) const { return m[col * 4 + row]; }
+		
+		
+		/**
+		 * Transform a point, applying the translation.
+		 */
+		Vector transformPoint (const Vector& point) const;
+		
+		/**
+		 * Transform a direction, ignoring the translation.
+		 */
+		Vector transformVector (const Vector& vector) const;
+		
+		
+		/* matrix construction */
+		static Matrix identity ();
+		static Matrix translation (const Vector& offset);
+		static Matrix scale (const Vector& factor);
+		static Matrix rotation (const Vector& axis, float degrees);
+		static Matrix lookAt (const Vector& eye, const Vector& interest, const Vector& up);
+		static Matrix skew (float degrees, const Vector& rotation, const Vector& translation);
+	};
+	
+	
+	/**
+	 * Concatenate two matrices.
+	 * The resulting matrix applies rhs first and then lhs.
+	 */
+	COLLADA_PARSER_API Matrix operator* (const Matrix& lhs, const Matrix& rhs);
+	
+	
+	/**
+	 * Concatenate two matrices into a preallocated result.
+	 * The result may not alias either of the inputs.
+	 */
+	COLLADA_PARSER_API void multiply (const Matrix& lhs, const Matrix& rhs, Matrix& result);
+
+}
+
+
+#endif /* COLLADA_PARSER_MATRIX_H_ */
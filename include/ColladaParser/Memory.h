@@ -0,0 +1,308 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+
+#ifndef COLLADA_PARSER_MEMORY_H_
+#define COLLADA_PARSER_MEMORY_H_
+
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <ColladaParser/Config.h>
+#include <ColladaParser/LoadFilter.h>
+#include <ColladaParser/StringPool.h>
+
+
+namespace ColladaParser
+{
+
+	/* forward declarations */
+	class Material; class Effect; class Geometry; class VisualScene;
+	class Node; class MappedFile; class MappedBuffer;
+	
+	
+	/**
+	 * What memory is held for.
+	 */
+	enum MemoryCategory
+	{
+		/* XML trees while elements are parsed, estimated */
+		MEMORY_DOM,
+		
+		/* document text kept for elements not parsed yet */
+		MEMORY_TEXT,
+		
+		/* source arrays, decoded or not */
+		MEMORY_SOURCES,
+		
+		/* primitive index arrays */
+		MEMORY_INDICES,
+		
+		/* the string pool */
+		MEMORY_STRINGS,
+		
+		/* scene nodes with their transforms and instances */
+		MEMORY_NODES,
+		
+		/* the library elements and their remaining parts */
+		MEMORY_ELEMENTS,
+		
+		MEMORY_CATEGORY_COUNT
+	};
+	
+	
+	
+	struct COLLADA_PARSER_API MemoryUsage
+	{
+		size_t bytes;
+		size_t count;
+		
+		MemoryUsage () : bytes(0), count(0) {}
+	};
+	
+	
+	
+	/**
+	 * Memory held by a document.
+	 * All sizes are approximate heap bytes. Data shared between elements
+	 * is counted once.
+	 */
+	struct COLLADA_PARSER_API MemoryStats
+	{
+		MemoryUsage categories[MEMORY_CATEGORY_COUNT];
+		
+		/* the elements of each library and everything they own. the
+		 * count is the number of elements */
+		MemoryUsage libraries[LIBRARY_COUNT];
+		
+		/* bytes of files mapped into memory, which are paged in by the
+		 * system rather than held on the heap */
+		size_t mapped;
+		
+		/* the most held at once since opening, in total and for each
+		 * category */
+		size_t peak;
+		size_t peaks[MEMORY_CATEGORY_COUNT];
+		
+		MemoryStats ();
+		
+		/* total of the categories */
+		size_t getBytes () const;
+	};
+	
+	
+	
+	/**
+	 * Thrown when parsing would hold more memory than its budget.
+	 */
+	class COLLADA_PARSER_API MemoryBudgetExceeded : public std::runtime_error
+	{
+	public:
+		MemoryBudgetExceeded (MemoryCategory category, size_t requested, size_t held, size_t budget);
+		
+		MemoryCategory getCategory() const { return mCategory; }
+		
+		/* bytes asked for, estimated or predicted from a count */
+		size_t getRequested() const { return mRequested; }
+		
+		/* bytes held at the time */
+		size_t getHeld() const { return mHeld; }
+		size_t getBudget() const { return mBudget; }
+		
+		
+	private:
+		MemoryCategory mCategory;
+		size_t mRequested;
+		size_t mHeld;
+		size_t mBudget;
+	};
+	
+	
+	
+	/**
+	 * Adds up the memory held by parsed elements.
+	 */
+	class COLLADA_PARSER_LOCAL MemoryCounter
+	{
+	public:
+		void add (const Material* material);
+		void add (const Effect* effect);
+		void add (const Geometry* geometry);
+		void add (const VisualScene* scene);
+		
+		/* a node and its children, owned by an element of the library */
+		void add (const Node* node, LibraryType library);
+		
+		/* an element of the given library */
+		void add (LibraryType library, const void* element);
+		
+		void addText (size_t bytes);
+		void addStrings (const StringStats& strings);
+		void addMapping (const MappedFile* file);
+		void addMapping (const MappedBuffer* buffer);
+		
+		const MemoryStats& getStats() const { return mStats; }
+		
+		
+	private:
+		MemoryStats mStats;
+		
+		/* shared arrays and mappings already counted */
+		std::unordered_set<const void*> mCounted;
+		
+		void add (MemoryCategory category, LibraryType library, size_t bytes, size_t count);
+	};
+	
+	
+	
+	/**
+	 * Tracks the memory held while parsing to find its peak.
+	 * 
+	 * The tracker is made current on the threads parsing for the owner
+	 * so memory held only during parsing can be accounted for.
+	 */
+	class COLLADA_PARSER_LOCAL MemoryTracker
+	{
+	public:
+		MemoryTracker ();
+		
+		
+		/* the tracker of the parse running on this thread, if any */
+		static MemoryTracker* getCurrent() { return sCurrent; }
+		
+		/* rough size of the XML tree parsed from the given text */
+		static size_t estimateDOM (size_t text) { return text * 6; }
+		
+		/* throw MemoryBudgetExceeded when the parse on this thread
+		 * can't take the given memory. used before allocations sized
+		 * by the document so bad counts fail early */
+		static void check (MemoryCategory category, size_t bytes)
+		{
+			if (MemoryTracker* tracker = sCurrent)
+				tracker->predict (category, bytes);
+		}
+		
+		
+		/* storage off the heap for an array of the given bytes when the
+		 * parse on this thread keeps arrays that large out of core,
+		 * otherwise null */
+		static std::shared_ptr<MappedBuffer> createBuffer (size_t bytes)
+		{
+			MemoryTracker* tracker = sCurrent;
+			return tracker ? tracker->map (bytes) : std::shared_ptr<MappedBuffer>();
+		}
+		
+		
+		/* zero is unlimited */
+		void setBudget (size_t bytes) { mBudget.store (bytes); }
+		size_t getBudget() const { return mBudget.load(); }
+		
+		/* throws MemoryBudgetExceeded when over budget */
+		void allocate (MemoryCategory category, size_t bytes);
+		void release (MemoryCategory category, size_t bytes);
+		
+		/* every category of the given stats */
+		void allocate (const MemoryStats& stats);
+		void release (const MemoryStats& stats);
+		
+		/* throws MemoryBudgetExceeded when the given memory won't fit.
+		 * arrays which will be kept out of core always fit */
+		void predict (MemoryCategory category, size_t bytes) const;
+		
+		
+		/* map arrays of at least the given bytes from temporary files
+		 * in the directory, or anonymously without one. zero keeps
+		 * everything on the heap */
+		void setOutOfCore (size_t bytes, const std::string& directory);
+		
+		/* storage for an array of the given bytes if it is large enough
+		 * to be kept out of core, otherwise null */
+		std::shared_ptr<MappedBuffer> map (size_t bytes) const;
+		
+		/* forget everything held and the peaks, but not the budget */
+		void reset ();
+		
+		/* fill in the peaks of the given stats. the string pool only
+		 * grows, so its current size is also its peak */
+		void getPeaks (MemoryStats& stats) const;
+		
+		
+		/* makes a tracker current on this thread for its lifetime */
+		class Scope
+		{
+		public:
+			explicit Scope (MemoryTracker* tracker) : mPrevious(sCurrent) { sCurrent = tracker; }
+			~Scope () { sCurrent = mPrevious; }
+			
+		private:
+			MemoryTracker* mPrevious;
+		};
+		
+		
+		/* holds memory on a tracker for its lifetime */
+		class Hold
+		{
+		public:
+			Hold (MemoryTracker* tracker, MemoryCategory category, size_t bytes)
+			: mTracker(tracker), mCategory(category), mBytes(bytes)
+			{
+				if (mTracker) mTracker->allocate (mCategory, mBytes);
+			}
+			
+			~Hold ()
+			{
+				if (mTracker) mTracker->release (mCategory, mBytes);
+			}
+			
+		private:
+			MemoryTracker* mTracker;
+			MemoryCategory mCategory;
+			size_t mBytes;
+		};
+		
+		
+	private:
+		static thread_local MemoryTracker* sCurrent;
+		
+		std::atomic<size_t> mBudget;
+		
+		/* out of core threshold and where the files go */
+		std::atomic<size_t> mOutOfCore;
+		std::string mDirectory;
+		mutable std::mutex mMutex;
+		
+		std::atomic<size_t> mTotal;
+		std::atomic<size_t> mPeak;
+		
+		std::atomic<size_t> mCurrent[MEMORY_CATEGORY_COUNT];
+		std::atomic<size_t> mPeaks[MEMORY_CATEGORY_COUNT];
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_MEMORY_H_ */
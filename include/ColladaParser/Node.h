@@ -27,9 +27,13 @@ THE SOFTWARE.
 #include <vector>
 #include <map>
 #include <string>
+#include <atomic>
 
 #include <ColladaParser/Config.h>
+#include <ColladaParser/Allocator.h>
 #include <ColladaParser/Types.h>
+#include <ColladaParser/Matrix.h>
+#include <ColladaParser/StringPool.h>
 
 
 /* forward declarations */
@@ -41,6 +45,9 @@ namespace ColladaParser
 
 	/* forward declarations */
 	class Node; class Transform; struct GeometryInstance;
+	class Geometry; class Material; class TransformEvaluator;
+	class Document;
+	class CacheReader; class CacheWriter;
 	
 	
 	/**
@@ -64,34 +71,63 @@ namespace ColladaParser
 	typedef std::vector<std::string> StringList;
 	
 	/**
-	 * A map of strings.
+	 * A map of interned strings, searchable by plain strings.
 	 */
-	typedef std::map<std::string, std::string> StringMap;
+	typedef std::map<InternedString, InternedString, std::less<> > StringMap;
+	
+	
+	
+	/**
+	 * A map of materials identified by their symbol.
+	 */
+	typedef std::map<std::string, Material*> MaterialMap;
 	
 	
 	
 	/**
 	 * Material instance binding.
+	 * The targets are resolved by the Document once it has been parsed,
+	 * or on first access through the instance in lazy documents.
 	 */
-	struct MaterialBinding
+	struct MaterialBinding : Allocated
 	{
 		StringMap materials;
+		MaterialMap targets;
 	};
 	
 	
 	
 	/**
 	 * Geometry instance.
+	 * The geometry is resolved from the url by the Document once it has
+	 * been parsed. Lazy documents leave it to the first getGeometry or
+	 * getMaterial call, so only the geometries and materials used are
+	 * parsed, and the fields are null until then.
 	 */
-	struct GeometryInstance
+	struct COLLADA_PARSER_API GeometryInstance : Allocated
 	{
-		std::string sid;
-		std::string name;
-		std::string url;
+		InternedString sid;
+		InternedString name;
+		InternedString url;
 		
 		MaterialBinding* materials;
+		Geometry* geometry;
+		
+		/* document resolving the instance on first access */
+		const Document* document;
+		mutable std::atomic<bool> resolved;
+		
+		GeometryInstance () : materials(0), geometry(0), document(0), resolved(false) {}
+		
+		
+		/* the instanced geometry */
+		Geometry* getGeometry () const;
 		
-		GeometryInstance () : materials(0) {}
+		/* the material bound to a symbol or null */
+		Material* getMaterial (const std::string& symbol) const;
+		
+		/* resolve now in lazy documents */
+		void resolve () const;
 	};
 	
 	
@@ -103,7 +139,7 @@ namespace ColladaParser
 	 * and defining any transformations on the associated instance and its
 	 * children.
 	 */
-	class COLLADA_PARSER_API Node
+	class COLLADA_PARSER_API Node : public Allocated
 	{
 	public:
 		/**
@@ -119,6 +155,13 @@ namespace ColladaParser
 		 */
 		Node (ticpp::Element* element);
 		
+		/**
+		 * Constructor.
+		 * Reads the node from a binary cache, without its children.
+		 * @param reader The cache to read from.
+		 */
+		Node (CacheReader& reader);
+		
 		/**
 		 * Destructor.
 		 */
@@ -128,17 +171,17 @@ namespace ColladaParser
 		/**
 		 * The node ID.
 		 */
-		std::string getID() const { return mID; }
+		const std::string& getID() const { return mID; }
 		
 		/**
 		 * The node name.
 		 */
-		std::string getName() const { return mName; }
+		const std::string& getName() const { return mName; }
 		
 		/**
 		 * The node SID.
 		 */
-		std::string getSID() const { return mSID; }
+		const std::string& getSID() const { return mSID; }
 		
 		/**
 		 * The node type.
@@ -158,6 +201,17 @@ namespace ColladaParser
 		const TransformList& getTransforms() const { return mTransforms; }
 		
 		
+		/**
+		 * The node transformations composed into a single local matrix.
+		 */
+		Matrix getLocalMatrix() const;
+		
+		/**
+		 * Changes whenever one of the node transformations is set.
+		 */
+		unsigned int getRevision() const { return mRevision; }
+		
+		
 		/**
 		 * A list of URLs to geometries that should be instanced.
 		 */
@@ -170,12 +224,32 @@ namespace ColladaParser
 		const NodeList& getChildren() const { return mChildren; }
 		
 		
+		/**
+		 * The parent node or null for root nodes.
+		 */
+		Node* getParent() const { return mParent; }
+		
+		/**
+		 * Write the node to a binary cache, without its children.
+		 */
+		void write (CacheWriter& writer) const;
+		
+		
 		
 	private:
+		/* rebuilds the hierarchy of cached nodes */
+		friend class VisualScene;
+		
+		/* flags the node when it is set */
+		friend class Transform;
+		
+		/* watches the node for set transforms */
+		friend class TransformEvaluator;
+		
 		/* properties */
-		std::string mID;
-		std::string mName;
-		std::string mSID;
+		InternedString mID;
+		InternedString mName;
+		InternedString mSID;
 		
 		Type mType;
 		StringList mLayers;
@@ -183,8 +257,23 @@ namespace ColladaParser
 		/* instances */
 		GeometryInstanceList mGeometries;
 		
+		Node* mParent;
 		NodeList mChildren;
 		TransformList mTransforms;
+		unsigned int mRevision;
+		
+		/* evaluators invalidated when a transform is set */
+		mutable std::vector<TransformEvaluator*> mEvaluators;
+		
+		
+		/* append a transform owned by the node */
+		void addTransform (Transform* transform);
+		
+		/* one of the transforms was set */
+		void changed ();
+		
+		/* free transforms, instances and children */
+		void release ();
 		
 		
 		/* parsing methods */
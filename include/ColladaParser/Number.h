@@ -0,0 +1,60 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef COLLADA_PARSER_NUMBER_H_
+#define COLLADA_PARSER_NUMBER_H_
+
+
+#include <charconv>
+
+
+namespace ColladaParser
+{
+
+	/**
+	 * Read a number from text, skipping the white space before it. The
+	 * number is read in the C locale whatever the locale of the process.
+	 * Returns the end of the number, or the start of the text when there
+	 * is no number.
+	 */
+	template <typename T>
+	inline const char* readNumber (const char* text, const char* end, T& value)
+	{
+		const char* begin = text;
+		
+		while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\n' || *begin == '\r'))
+			begin++;
+		
+		/* a leading plus is valid in a document */
+		if (begin + 1 < end && *begin == '+' && *(begin + 1) != '-')
+			begin++;
+		
+		
+		std::from_chars_result result = std::from_chars (begin, end, value);
+		return result.ptr == begin ? text : result.ptr;
+	}
+
+}
+
+
+#endif /* COLLADA_PARSER_NUMBER_H_ */
@@ -27,10 +27,13 @@ THE SOFTWARE.
 #include <string>
 
 #include <ColladaParser/Config.h>
+#include <ColladaParser/Allocator.h>
+#include <ColladaParser/Hash.h>
 
 
 /* forward declarations */
 namespace ticpp { class Element; }
+namespace ColladaParser { class CacheReader; class CacheWriter; }
 
 
 namespace ColladaParser
@@ -44,11 +47,11 @@ namespace ColladaParser
 	
 	
 	
-	class COLLADA_PARSER_API ProfileCommon
+	class COLLADA_PARSER_API ProfileCommon : public Allocated
 	{
 	public:
 		/* common properties to all shader elements */
-		struct COLLADA_PARSER_API ShaderCommon
+		struct COLLADA_PARSER_API ShaderCommon : Allocated
 		{
 			Colour emission;
 			Colour reflective;
@@ -100,19 +103,38 @@ namespace ColladaParser
 		
 		
 		ProfileCommon (ticpp::Element* element);
+		ProfileCommon (CacheReader& reader);
 		~ProfileCommon ();
 		
 		
 		std::string getID() { return mID; }
 		const Technique& getTechnique() { return mTechnique; }
 		
+		/* hash of the shader values, texture references and parameters,
+		 * ignoring ids and sids */
+		const Hash& getHash() const { return mHash; }
+		
+		/* compare everything hashed */
+		bool isEqual (const ProfileCommon& profile) const;
+		
+		
+		void write (CacheWriter& writer) const;
+		
 		
 	private:
 		std::string mID;
 		Technique mTechnique;
+		Hash mHash;
+		
+		/* newparam and image elements and the texture references of the
+		 * shaders as written, since they aren't parsed into values */
+		std::string mParams;
+		
+		void computeHash ();
 		
 		void parse (ticpp::Element* element);
 		void parseShaderCommon (ticpp::Element* element, ShaderCommon* shader);
+		void parseTextures (ticpp::Element* technique);
 		
 		void parseBlinn    (ticpp::Element* element);
 		void parseConstant (ticpp::Element* element);
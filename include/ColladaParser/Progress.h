@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+
+#ifndef COLLADA_PARSER_PROGRESS_H_
+#define COLLADA_PARSER_PROGRESS_H_
+
+
+#include <mutex>
+#include <atomic>
+
+#include <ColladaParser/Config.h>
+#include <ColladaParser/Document.h>
+
+
+namespace ColladaParser
+{
+
+	/**
+	 * Progress and cancellation of an open.
+	 * 
+	 * The monitor is made current on every thread working on the open so
+	 * the parsing loops can check for cancellation without being handed
+	 * the document.
+	 */
+	class COLLADA_PARSER_LOCAL ProgressMonitor
+	{
+	public:
+		ProgressMonitor (const std::atomic<bool>& cancelled, const ProgressCallback& callback);
+		
+		
+		/* the monitor of the open running on this thread, if any */
+		static ProgressMonitor* getCurrent() { return sCurrent; }
+		
+		/* throw OpenCancelled when the open on this thread was cancelled */
+		static void check ()
+		{
+			ProgressMonitor* monitor = sCurrent;
+			
+			if (monitor && monitor->mCancelled.load (std::memory_order_relaxed))
+				throw OpenCancelled ();
+		}
+		
+		
+		void setTotal (size_t bytes, size_t elements);
+		
+		/* add to the work done and report it */
+		void advance (size_t bytes, size_t elements);
+		
+		/* report everything as done */
+		void finish ();
+		
+		
+		/* makes a monitor current on this thread for its lifetime */
+		class Scope
+		{
+		public:
+			explicit Scope (ProgressMonitor* monitor) : mPrevious(sCurrent) { sCurrent = monitor; }
+			~Scope () { sCurrent = mPrevious; }
+			
+		private:
+			ProgressMonitor* mPrevious;
+		};
+		
+		
+	private:
+		static thread_local ProgressMonitor* sCurrent;
+		
+		const std::atomic<bool>& mCancelled;
+		ProgressCallback mCallback;
+		
+		std::mutex mMutex;
+		OpenProgress mProgress;
+		
+		void report ();
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_PROGRESS_H_ */
@@ -26,11 +26,15 @@ THE SOFTWARE.
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <stdint.h>
 
 #include <ColladaParser/Config.h>
 #include <ColladaParser/Effect.h>
 #include <ColladaParser/Geometry.h>
 #include <ColladaParser/VisualScene.h>
+#include <ColladaParser/LoadFilter.h>
+#include <ColladaParser/Memory.h>
 
 
 
@@ -49,11 +53,60 @@ namespace ColladaParser
 		{
 			std::string id;
 			std::string name;
+			
+			/* from the count attributes of the position accessor and
+			 * the primitives. triangles and lines are counted from the
+			 * attribute alone, the other primitives from the values of
+			 * their vcount or p, which are counted but not converted */
+			unsigned int vertexCount;
+			unsigned int primitiveCount;
+			unsigned int indexCount;
+			
+			GeometryInfo () : vertexCount(0), primitiveCount(0), indexCount(0) {}
 		};
 		
 		
 		/* document elements */
 		std::vector<GeometryInfo> geometries;
+		
+		unsigned int materialCount;
+		unsigned int effectCount;
+		unsigned int nodeCount;
+		
+		
+		/* asset unit and up axis, spec defaults when not given */
+		float unitMeter;
+		std::string unitName;
+		std::string upAxis;
+		
+		
+		DocumentInfo ()
+		: materialCount(0), effectCount(0), nodeCount(0),
+		  unitMeter(1.0f), unitName("meter"), upAxis("Y_UP") {}
+	};
+	
+	
+	
+	
+	/* an input of a streamed primitive or vertices element */
+	struct COLLADA_PARSER_API StreamInput
+	{
+		std::string semantic;
+		std::string source;
+		unsigned int offset;
+	};
+	
+	
+	/* a streamed primitive, sent before its indices */
+	struct COLLADA_PARSER_API StreamPrimitive
+	{
+		std::string type;
+		std::string material;
+		
+		unsigned int count;
+		unsigned int stride;
+		
+		std::vector<StreamInput> inputs;
 	};
 	
 	
@@ -62,9 +115,39 @@ namespace ColladaParser
 	class COLLADA_PARSER_API ReaderHandler
 	{
 	public:
-		virtual void loadEffect (Effect* effect) {}
-		virtual void loadGeometry (Geometry* geometry) {}
-		virtual void loadVisualScene (VisualScene* scene) {}
+		/* the element is freed by the reader once the call returns */
+		virtual void loadEffect (Effect*) {}
+		virtual void loadGeometry (Geometry*) {}
+		virtual void loadVisualScene (VisualScene*) {}
+		
+		
+		/* the handler owns the element and may keep it. by default the
+		 * element is passed on to the load callback and freed after */
+		virtual void takeEffect (std::unique_ptr<Effect> effect) { loadEffect (effect.get()); }
+		virtual void takeGeometry (std::unique_ptr<Geometry> geometry) { loadGeometry (geometry.get()); }
+		virtual void takeVisualScene (std::unique_ptr<VisualScene> scene) { loadVisualScene (scene.get()); }
+		
+		
+		/* chunked geometry streaming, used in place of the geometry
+		 * callbacks when the reader has a chunk size. the callbacks are
+		 * made on the parsing thread while the text is decoded and the
+		 * chunk data is only valid during the call. with handler threads
+		 * the elements queued before a geometry are handled first, so
+		 * the handler is never called concurrently with a stream. a
+		 * source whose array has no count begins with a count of zero
+		 * and streams every value of the array */
+		virtual void beginGeometry (const std::string&, const std::string&) {}
+		
+		virtual void beginSource (const std::string&, unsigned int, unsigned int) {}
+		virtual void onSourceChunk (const std::string&, size_t, const float*, size_t) {}
+		
+		virtual void onVertices (const std::string&, const std::vector<StreamInput>&) {}
+		
+		virtual void beginPrimitive (const StreamPrimitive&) {}
+		virtual void onIndexChunk (size_t, const uint32_t*, size_t) {}
+		virtual void endPrimitive () {}
+		
+		virtual void endGeometry () {}
 	};
 	
 	
@@ -80,9 +163,86 @@ namespace ColladaParser
 		DocumentInfo getInfo ();
 		
 		
+		/* only pass the elements and nodes the filter accepts to the
+		 * handler, everything else is skipped unparsed */
+		void setFilter (const LoadFilter& filter) { mFilter = filter; }
+		
+		
+		/* call the handler from worker threads while parsing carries on.
+		 * zero calls it on the parsing thread as each element is read */
+		void setHandlerThreads (unsigned int threads) { mHandlerThreads = threads; }
+		
+		/* parsed elements allowed to wait for a handler thread. parsing
+		 * blocks while the queue is full, which caps the memory held */
+		void setQueueSize (size_t size) { mQueueSize = size; }
+		
+		/* deliver elements one at a time in document order, otherwise
+		 * the handler threads call the handler concurrently */
+		void setOrdered (bool ordered) { mOrdered = ordered; }
+		
+		/* stream geometries through the chunk callbacks, decoding at
+		 * most this many values at a time. zero builds Geometry objects.
+		 * each streamed geometry waits for the handler threads to finish
+		 * the elements before it, so the chunk callbacks never overlap
+		 * them and ordered delivery stays in document order */
+		void setChunkSize (size_t values) { mChunkSize = values; }
+		
+		/* collapse runs of white space in element text to single spaces
+		 * while parsing, on by default */
+		void setCondenseWhiteSpace (bool condense) { mCondenseWhiteSpace = condense; }
+		
+		
+		/* strings shared by every element read. the elements keep them
+		 * alive after the reader is gone */
+		StringStats getStringStats() const { return mStrings->getStats(); }
+		
+		/* elements are only held until the handler takes them, so the
+		 * categories and libraries add up everything read by the last
+		 * open while the peak is the most held at once */
+		MemoryStats getMemoryStats() const;
+		
+		/* fail with MemoryBudgetExceeded when the reader would hold more
+		 * than the given bytes, counting elements waiting for a handler
+		 * thread. zero is unlimited */
+		void setMemoryBudget (size_t bytes) { mMemory.setBudget (bytes); }
+		
+		/* keep source and index arrays of at least the given bytes off
+		 * the heap, mapped from temporary files in the directory so the
+		 * system can page them out, or mapped anonymously without one.
+		 * mapped arrays don't count against the budget. zero keeps
+		 * every array on the heap */
+		void setOutOfCore (size_t bytes, const std::string& directory = std::string());
+		
+		
 	private:
+		/* queue between the parser and the handler threads */
+		class Pipeline;
+		
 		std::string mFile;
 		ReaderHandler *mHandler;
+		LoadFilter mFilter;
+		
+		unsigned int mHandlerThreads;
+		size_t mQueueSize;
+		bool mOrdered;
+		Pipeline* mPipeline;
+		
+		size_t mChunkSize;
+		bool mCondenseWhiteSpace;
+		std::shared_ptr<StringPool> mStrings;
+		
+		MemoryStats mRead;
+		MemoryTracker mMemory;
+		
+		
+		bool parse ();
+		bool parseScanned ();
+		
+		void streamGeometry (const Scanner& scanner, const Scanner::Element& element);
+		void streamSource (const Scanner& scanner, const Scanner::Element& element);
+		void streamPrimitive (const Scanner& scanner, const Scanner::Element& element);
+		
+		void dispatch (LibraryType type, void* object);
 		
 		
 		void parseEffects      (ticpp::Element* element);
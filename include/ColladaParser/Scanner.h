@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef COLLADA_PARSER_SCANNER_H_
+#define COLLADA_PARSER_SCANNER_H_
+
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include <ColladaParser/Config.h>
+
+
+namespace ColladaParser
+{
+
+	/**
+	 * Forward only scanner over XML text which locates elements without
+	 * building a document tree. It understands just enough of XML to skip
+	 * comments, CDATA sections, processing instructions and quoted
+	 * attribute values so that nested elements can be matched.
+	 */
+	class COLLADA_PARSER_LOCAL Scanner
+	{
+	public:
+		/* byte range of an element within the text */
+		struct Element
+		{
+			std::string name;
+			std::string id;
+			
+			size_t begin;       /* offset of the opening '<' */
+			size_t end;         /* offset past the closing '>' */
+			
+			size_t content;     /* offset past the start tag */
+			size_t contentEnd;  /* offset of the end tag */
+			
+			Element () : begin(0), end(0), content(0), contentEnd(0) {}
+		};
+		
+		
+		Scanner (const char* data, size_t size);
+		
+		
+		const char* getData() const { return mData; }
+		size_t getSize() const { return mSize; }
+		
+		
+		/* find the document root element */
+		Element getRoot () const;
+		
+		/* list the child elements of an element */
+		void getChildren (const Element& parent, std::vector<Element>& children) const;
+		
+		/* count the elements of a name at any depth below an element,
+		 * in a single pass over its content */
+		size_t countElements (const Element& parent, const std::string& name) const;
+		
+		/* value of an attribute on the start tag, empty when missing */
+		std::string getAttribute (const Element& element, const std::string& name) const;
+		
+		/* raw text between the start and end tag */
+		std::string getText (const Element& element) const;
+		
+		/* raw text of the whole element */
+		std::string getSource (const Element& element) const;
+		
+		
+	private:
+		const char* mData;
+		size_t mSize;
+		
+		
+		size_t skipMarkup (size_t pos) const;
+		size_t skipStartTag (size_t pos, bool& empty) const;
+		size_t parseElement (size_t pos, Element& element) const;
+		size_t findEndTag (size_t pos) const;
+		size_t find (size_t pos, const char* token) const;
+		
+		void fail (const std::string& message, size_t pos) const;
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_SCANNER_H_ */
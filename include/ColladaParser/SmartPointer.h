@@ -25,6 +25,7 @@ THE SOFTWARE.
 
 
 #include <cassert>
+#include <atomic>
 
 #include <ColladaParser/Config.h>
 
@@ -50,16 +51,21 @@ namespace ColladaParser
 		ReferenceCounter() : mCount(0) {}
 		virtual ~ReferenceCounter() {}
 		
+		/* a copy is a new object without any references */
+		ReferenceCounter (const ReferenceCounter&) : mCount(0) {}
+		ReferenceCounter& operator= (const ReferenceCounter&) { return *this; }
+		
 		
 	private:
-		int mCount;
+		/* references may be copied and released on several threads */
+		std::atomic<int> mCount;
 		
-		/* counter operations */
-		void increment() { ++mCount; }
-		void decrement() { --mCount; }
+		/* counter operations, decrement returns the remaining count */
+		void increment() { mCount.fetch_add (1, std::memory_order_relaxed); }
+		int decrement() { return mCount.fetch_sub (1, std::memory_order_acq_rel) - 1; }
 		
 		/* get current reference count */
-		int value() { return mCount; }
+		int value() { return mCount.load (std::memory_order_acquire); }
 	};
 	
 	
@@ -219,11 +225,8 @@ namespace ColladaParser
 			{
 				assert (mCounter->value() > 0);
 				
-				/* decrease reference */
-				mCounter->decrement();
-				
-				/* free pointer */
-				if (mCounter->value() == 0)
+				/* decrease reference, only the last one sees zero */
+				if (mCounter->decrement() == 0)
 					/* use base destructor to allow incomplete types */
 					delete mCounter;
 				
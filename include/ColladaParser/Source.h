@@ -24,9 +24,14 @@ THE SOFTWARE.
 #define COLLADA_PARSER_SOURCE_H_
 
 #include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
 
 #include <ColladaParser/Config.h>
+#include <ColladaParser/Allocator.h>
 #include <ColladaParser/DataSource.h>
+#include <ColladaParser/StringPool.h>
 
 
 /* forward declarations */
@@ -35,32 +40,84 @@ namespace ticpp { class Element; }
 
 namespace ColladaParser
 {
+	class MappedFile;
+	class MappedBuffer;
+	class CacheReader;
+	class CacheWriter;
+	
 
 	class COLLADA_PARSER_API Source : public DataSource
 	{
 	public:
 		Source (ticpp::Element *element);
+		Source (CacheReader& reader);
 		~Source ();
 		
 		
 		const std::string &getID()   { return mID; }
 		const std::string &getName() { return mName; }
 		
+		/* size in bytes of the decoded data */
+		size_t getDataSize() const { return mData->count * sizeof (float); }
+		
+		/* whether the array text has been decoded yet */
+		bool isDecoded() const { return mData->decoded.load (std::memory_order_acquire); }
+		
+		
+		void write (CacheWriter& writer) const;
+		
 		
 	private:
+		friend class Document;
+		friend class MemoryCounter;
+		
 		/* source properties */
-		std::string mID;
-		std::string mName;
-		std::vector<float> mData;
+		InternedString mID;
+		InternedString mName;
+		
+		/* array text which is only decoded on first data access. arrays
+		 * read from a cache point into the mapped file instead, and
+		 * arrays kept out of core are decoded straight into a buffer */
+		struct Array : Allocated
+		{
+			std::string text;
+			unsigned int count;
+			std::vector<float, ContainerAllocator<float> > values;
+			
+			const float* data;
+			std::shared_ptr<MappedFile> mapping;
+			std::shared_ptr<MappedBuffer> buffer;
+			
+			std::atomic<bool> decoded;
+			std::once_flag once;
+			
+			Array () : count(0), data(0), decoded(false) {}
+		};
+		
+		std::shared_ptr<Array> mData;
 		
 		Accessor mAccessor;
+		Hash mHash;
 		
 		
 		/* data source implementation */
 		int getCount() { return mAccessor.count; }
-		float getData (int index) { return mData[index]; }
+		float getData (int index)
+		{
+			if (!mData->decoded.load (std::memory_order_acquire))
+				decode ();
+			
+			return mData->data[index];
+		}
 		
 		const Accessor &getAccessor() { return mAccessor; }
+		Hash getHash() { return mHash; }
+		bool isEqual (DataSource* source);
+		
+		
+		/* share the data array of an identical source */
+		void share (const Source& source) { mData = source.mData; }
+		bool isSharing (const Source& source) const { return mData == source.mData; }
 		
 		
 		/* parsing methods */
@@ -68,6 +125,8 @@ namespace ColladaParser
 		void parseAccessor (ticpp::Element *element);
 		
 		DataType parseType (std::string type);
+		void computeHash ();
+		void decode () const;
 	};
 
 }
@@ -0,0 +1,141 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef COLLADA_PARSER_STATIC_BATCH_H_
+#define COLLADA_PARSER_STATIC_BATCH_H_
+
+
+#include <vector>
+#include <functional>
+
+#include <ColladaParser/Config.h>
+#include <ColladaParser/Types.h>
+#include <ColladaParser/Geometry.h>
+#include <ColladaParser/Node.h>
+
+
+namespace ColladaParser
+{
+
+	/* forward declarations */
+	class TransformEvaluator;
+	
+	
+	/**
+	 * Static batch.
+	 * 
+	 * Merges the primitives of static geometry instances that are bound to
+	 * the same material into large shared vertex and index buffers. The
+	 * vertices are pre-transformed into world space and a range table
+	 * records where every original instance primitive ended up.
+	 * 
+	 * The buffer sizes are known up front from the index counts, so the
+	 * buffers are allocated once and every range is written in parallel
+	 * straight into its own slice.
+	 */
+	class COLLADA_PARSER_API StaticBatch
+	{
+	public:
+		/**
+		 * A world space vertex.
+		 */
+		struct COLLADA_PARSER_API Vertex
+		{
+			Vector position;
+			Vector normal;
+			TexCoord texcoord;
+		};
+		
+		
+		/**
+		 * The shared buffers of a single material.
+		 */
+		struct COLLADA_PARSER_API Batch
+		{
+			const Material* material;
+			
+			std::vector<Vertex> vertices;
+			std::vector<unsigned int> indices;
+		};
+		
+		
+		/**
+		 * The slice of a batch holding an instance primitive.
+		 */
+		struct COLLADA_PARSER_API Range
+		{
+			const Node* node;
+			const GeometryInstance* geometry;
+			const Primitive* primitive;
+			
+			/* index of the node in the transform evaluator */
+			size_t transform;
+			
+			size_t batch;
+			size_t firstVertex;
+			size_t vertexCount;
+			size_t firstIndex;
+			size_t indexCount;
+		};
+		
+		
+		/**
+		 * Decides whether a geometry instance is static and can be merged.
+		 */
+		typedef std::function<bool (const Node* node, const GeometryInstance* geometry)> Filter;
+		
+		
+		/**
+		 * Constructor.
+		 * Merges the geometry instances of the evaluated scene.
+		 * @param transforms The evaluated scene transforms.
+		 * @param filter Selects the static instances, all when empty.
+		 * @param threads The amount of threads to use, zero for all cores.
+		 */
+		StaticBatch (const TransformEvaluator* transforms, const Filter& filter = Filter(), unsigned int threads = 0);
+		
+		
+		/**
+		 * The merged buffers, one for each material.
+		 */
+		const std::vector<Batch>& getBatches() const { return mBatches; }
+		
+		/**
+		 * Where each merged instance primitive is found.
+		 */
+		const std::vector<Range>& getRanges() const { return mRanges; }
+		
+		
+	private:
+		std::vector<Batch> mBatches;
+		std::vector<Range> mRanges;
+		
+		
+		void plan (const TransformEvaluator* transforms, const Filter& filter);
+		void write (const TransformEvaluator* transforms, const Range& range);
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_STATIC_BATCH_H_ */
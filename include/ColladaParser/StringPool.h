@@ -0,0 +1,188 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+
+#ifndef COLLADA_PARSER_STRING_POOL_H_
+#define COLLADA_PARSER_STRING_POOL_H_
+
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+#include <ColladaParser/Config.h>
+
+
+namespace ColladaParser
+{
+
+	/**
+	 * What an interned string is used for.
+	 */
+	enum StringCategory
+	{
+		STRING_ID,
+		STRING_NAME,
+		STRING_SID,
+		STRING_URL,
+		STRING_SYMBOL,
+		
+		STRING_CATEGORY_COUNT
+	};
+	
+	
+	
+	/**
+	 * Memory held by a string pool.
+	 * Each distinct string is counted under the category it was first
+	 * interned with.
+	 */
+	struct COLLADA_PARSER_API StringStats
+	{
+		struct Category
+		{
+			/* distinct strings */
+			size_t strings;
+			
+			/* approximate bytes held, bookkeeping included */
+			size_t bytes;
+			
+			/* times a string was interned */
+			size_t references;
+			
+			Category () : strings(0), bytes(0), references(0) {}
+		};
+		
+		Category categories[STRING_CATEGORY_COUNT];
+		
+		size_t getStrings () const;
+		size_t getBytes () const;
+	};
+	
+	
+	
+	/**
+	 * A string held by a string pool.
+	 * 
+	 * Interned strings are a pointer into their pool, copying one never
+	 * copies the text and strings from the same pool compare by address.
+	 * The pool must outlive the string.
+	 */
+	class COLLADA_PARSER_API InternedString
+	{
+		friend class StringPool;
+		
+	public:
+		/* the empty string, which belongs to no pool */
+		InternedString ();
+		
+		
+		const std::string& str () const { return *mString; }
+		operator const std::string& () const { return *mString; }
+		
+		const char* c_str () const { return mString->c_str(); }
+		size_t size () const { return mString->size(); }
+		bool empty () const { return mString->empty(); }
+		
+		
+		bool operator== (const InternedString& other) const { return mString == other.mString || *mString == *other.mString; }
+		bool operator!= (const InternedString& other) const { return !(*this == other); }
+		bool operator< (const InternedString& other) const { return mString != other.mString && *mString < *other.mString; }
+		
+		
+	private:
+		const std::string* mString;
+		
+		explicit InternedString (const std::string* string) : mString(string) {}
+	};
+	
+	
+	inline bool operator== (const InternedString& a, const std::string& b) { return a.str() == b; }
+	inline bool operator== (const std::string& a, const InternedString& b) { return a == b.str(); }
+	inline bool operator!= (const InternedString& a, const std::string& b) { return a.str() != b; }
+	inline bool operator!= (const std::string& a, const InternedString& b) { return a != b.str(); }
+	
+	/* lookups by plain string in ordered containers */
+	inline bool operator< (const InternedString& a, const std::string& b) { return a.str() < b; }
+	inline bool operator< (const std::string& a, const InternedString& b) { return a < b.str(); }
+	
+	
+	
+	/**
+	 * String pool.
+	 * 
+	 * Holds one copy of every distinct string interned into it. A pool is
+	 * made current on the threads parsing a document so every element of
+	 * it shares the same strings. The library elements keep their pool
+	 * alive for as long as they exist.
+	 */
+	class COLLADA_PARSER_API StringPool
+	{
+	public:
+		StringPool ();
+		~StringPool ();
+		
+		
+		/* the single copy of the given text. safe to call concurrently */
+		InternedString intern (const std::string& text, StringCategory category);
+		
+		StringStats getStats () const;
+		
+		
+		/* the pool current on this thread. elements which don't own a
+		 * pool, such as nodes and sources, must be built while their
+		 * owner's pool is current and fail otherwise */
+		static StringPool* getCurrent ();
+		
+		/* the pool current on this thread, or a new pool when no pool
+		 * is current */
+		static std::shared_ptr<StringPool> acquire ();
+		
+		
+		/* makes a pool current on this thread for its lifetime */
+		class COLLADA_PARSER_API Scope
+		{
+		public:
+			explicit Scope (const std::shared_ptr<StringPool>& pool);
+			~Scope ();
+			
+		private:
+			const std::shared_ptr<StringPool>* mPrevious;
+		};
+		
+		
+	private:
+		mutable std::mutex mMutex;
+		std::unordered_set<std::string> mStrings;
+		StringStats mStats;
+		
+		/* not copyable */
+		StringPool (const StringPool&);
+		StringPool& operator= (const StringPool&);
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_STRING_POOL_H_ */
@@ -0,0 +1,106 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef COLLADA_PARSER_THREAD_POOL_H_
+#define COLLADA_PARSER_THREAD_POOL_H_
+
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include <ColladaParser/Config.h>
+
+
+namespace ColladaParser
+{
+
+	/**
+	 * Thread pool.
+	 * 
+	 * A fixed set of worker threads used to spread independent pieces of
+	 * work over the available cores. The calling thread always takes part
+	 * in the work it hands out, so a pool with a single thread simply runs
+	 * everything in place.
+	 */
+	class COLLADA_PARSER_API ThreadPool
+	{
+	public:
+		/**
+		 * A task operating on the index range [begin, end).
+		 */
+		typedef std::function<void (size_t begin, size_t end)> RangeTask;
+		
+		
+		/**
+		 * Constructor.
+		 * @param threads The total amount of threads including the caller.
+		 *                Zero uses the hardware concurrency.
+		 */
+		explicit ThreadPool (unsigned int threads = 0);
+		
+		/**
+		 * Destructor.
+		 * Waits for the workers to finish.
+		 */
+		~ThreadPool ();
+		
+		
+		/**
+		 * The total amount of threads including the caller.
+		 */
+		unsigned int getThreadCount() const { return mWorkers.size() + 1; }
+		
+		
+		/**
+		 * Run a task over the range [0, count) in chunks of grain size and
+		 * block until every chunk has completed. The first exception thrown
+		 * by a chunk is rethrown on the calling thread.
+		 */
+		void parallelFor (size_t count, size_t grain, const RangeTask& task);
+		
+		
+	private:
+		/* state shared by the chunks of a single parallelFor call */
+		struct Batch;
+		
+		std::vector<std::thread> mWorkers;
+		std::deque<Batch*> mQueue;
+		
+		std::mutex mMutex;
+		std::condition_variable mWake;
+		std::condition_variable mDone;
+		bool mStopping;
+		
+		
+		void work ();
+		void runChunks (Batch* batch);
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_THREAD_POOL_H_ */
@@ -27,11 +27,15 @@ THE SOFTWARE.
 #include <string>
 
 #include <ColladaParser/Config.h>
+#include <ColladaParser/Allocator.h>
 #include <ColladaParser/Types.h>
+#include <ColladaParser/Matrix.h>
+#include <ColladaParser/StringPool.h>
 
 
 /* forward declarations */
 namespace ticpp { class Element; }
+namespace ColladaParser { class CacheReader; class CacheWriter; class Node; }
 
 
 namespace ColladaParser
@@ -45,7 +49,7 @@ namespace ColladaParser
 	 * all possible kinds of transformations and should be applied to
 	 * the element in the order found within the document.
 	 */
-	class COLLADA_PARSER_API Transform
+	class COLLADA_PARSER_API Transform : public Allocated
 	{
 	public:
 		/**
@@ -62,6 +66,13 @@ namespace ColladaParser
 		 */
 		Transform (Type type, ticpp::Element* element);
 		
+		/**
+		 * Constructor.
+		 * Reads a transform from a binary cache.
+		 * @param reader The cache to read from.
+		 */
+		Transform (CacheReader& reader);
+		
 		
 		/**
 		 * The transform type.
@@ -80,31 +91,96 @@ namespace ColladaParser
 		/**
 		 * The transform translation vector.
 		 */
-		const Vector& getTranslation() { return mData.vec; }
+		const Vector& getTranslation() const { return mVector; }
 		
 		
 		/**
 		 * The transform scale vector.
 		 */
-		const Vector& getScale() { return mData.vec; }
+		const Vector& getScale() const { return mVector; }
 		
 		
 		/**
 		 * The transform rotation vector.
+		 * 
+		 * Only holds the angle on the first non-zero axis and is kept for
+		 * compatibility. Use getAxis() and getAngle() or getMatrix() for
+		 * rotations about an arbitrary axis.
+		 */
+		const Vector& getRotation() const { return mRotation; }
+		
+		
+		/**
+		 * The transform rotation axis.
+		 */
+		const Vector& getAxis() const { return mVector; }
+		
+		
+		/**
+		 * The transform rotation angle in degrees.
+		 */
+		float getAngle() const { return mAngle; }
+		
+		
+		/**
+		 * The transform as a 4x4 matrix.
+		 * Available for every transform type.
+		 */
+		const Matrix& getMatrix() const { return mMatrix; }
+		
+		
+		
+		/**
+		 * Replace the transform with a translation.
+		 * The transform type becomes TRANSLATE.
+		 * 
+		 * Every setter bumps the revision of the owning node, so only its
+		 * subtree is recomputed on the next TransformEvaluator::update().
+		 */
+		void setTranslation (const Vector& translation);
+		
+		/**
+		 * Replace the transform with a scale.
+		 * The transform type becomes SCALE.
+		 */
+		void setScale (const Vector& scale);
+		
+		/**
+		 * Replace the transform with a rotation about an axis.
+		 * The transform type becomes ROTATE.
 		 */
-		const Vector& getRotation() { return mData.vec; }
+		void setRotation (const Vector& axis, float angle);
+		
+		/**
+		 * Replace the transform with an arbitrary matrix.
+		 * The transform type becomes MATRIX.
+		 */
+		void setMatrix (const Matrix& matrix);
+		
+		/**
+		 * Write the transform to a binary cache.
+		 */
+		void write (CacheWriter& writer) const;
 		
 		
 	private:
+		friend class Node;
+		
 		Type mType;
-		std::string mSID;
+		InternedString mSID;
+		
+		/* node the transform belongs to */
+		Node* mNode;
+		
+		Vector mVector;
+		Vector mRotation;
+		float mAngle;
 		
+		Matrix mMatrix;
 		
-		union
-		{
-			Vector vec;
-		} mData;
 		
+		/* flag the owning node */
+		void touch ();
 		
 		/* parsing methods */
 		void parse (ticpp::Element* element);
@@ -0,0 +1,186 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef COLLADA_PARSER_TRANSFORM_EVALUATOR_H_
+#define COLLADA_PARSER_TRANSFORM_EVALUATOR_H_
+
+
+#include <vector>
+#include <unordered_map>
+
+#include <ColladaParser/Config.h>
+#include <ColladaParser/Matrix.h>
+#include <ColladaParser/VisualScene.h>
+
+
+namespace ColladaParser
+{
+
+	/* forward declarations */
+	class ThreadPool;
+	
+	
+	/**
+	 * Transform evaluator.
+	 * 
+	 * Flattens the node hierarchy of a visual scene into arrays ordered by
+	 * depth so that every parent precedes its children. Local matrices are
+	 * composed from each node's transform stack and world matrices are then
+	 * propagated one level at a time, splitting wide levels over a thread
+	 * pool.
+	 * 
+	 * After the initial evaluation the matrices are cached. Scene edits
+	 * mark nodes dirty and update() only recomputes the dirty subtrees,
+	 * spreading independent subtrees over the pool. Setting a transform of
+	 * a node invalidates the node in every evaluator of its scene, so
+	 * updates only touch what was edited. Edits, updates and evaluators
+	 * being created or destroyed must not run concurrently with each
+	 * other, and evaluators must be destroyed before their scene.
+	 */
+	class COLLADA_PARSER_API TransformEvaluator
+	{
+	public:
+		/**
+		 * Constructor.
+		 * Flattens the node hierarchy of the given scene.
+		 * @param scene The visual scene to evaluate.
+		 * @param threads The amount of threads to use, zero for all cores.
+		 */
+		TransformEvaluator (const VisualScene* scene, unsigned int threads = 0);
+		
+		/**
+		 * Destructor.
+		 */
+		~TransformEvaluator ();
+		
+		
+		/**
+		 * Compose the local matrices and propagate the world matrices of
+		 * every node in the scene.
+		 */
+		void evaluate ();
+		
+		
+		/**
+		 * Recompute the matrices of the nodes marked dirty since the last
+		 * evaluation along with their subtrees.
+		 */
+		void update ();
+		
+		
+		/**
+		 * Mark the transform stack of a node as changed.
+		 * Its local matrix is recomposed on the next update.
+		 */
+		void invalidate (size_t index);
+		void invalidate (const Node* node);
+		
+		/**
+		 * Override the local matrix of a node until it is next invalidated
+		 * or the scene is fully evaluated.
+		 */
+		void setLocalMatrix (size_t index, const Matrix& local);
+		void setLocalMatrix (const Node* node, const Matrix& local);
+		
+		
+		/**
+		 * Whether any node is waiting on an update.
+		 */
+		bool isDirty() const { return !mDirtyList.empty(); }
+		
+		
+		/**
+		 * The amount of nodes in the scene.
+		 */
+		size_t getNodeCount() const { return mNodes.size(); }
+		
+		/**
+		 * The node at the given index.
+		 */
+		const Node* getNode (size_t index) const { return mNodes[index]; }
+		
+		/**
+		 * The index of the given node or -1 if it isn't part of the scene.
+		 */
+		int getIndex (const Node* node) const;
+		
+		/**
+		 * The index of the parent node or -1 for root nodes.
+		 */
+		int getParent (size_t index) const { return mParents[index]; }
+		
+		
+		/**
+		 * The local matrix of the node at the given index.
+		 */
+		const Matrix& getLocalMatrix (size_t index) const { return mLocal[index]; }
+		
+		/**
+		 * The world matrix of the node at the given index.
+		 */
+		const Matrix& getWorldMatrix (size_t index) const { return mWorld[index]; }
+		
+		/**
+		 * The world matrix of the given node.
+		 */
+		const Matrix& getWorldMatrix (const Node* node) const;
+		
+		
+	private:
+		/* flattened hierarchy */
+		std::vector<const Node*> mNodes;
+		std::vector<int> mParents;
+		std::vector<size_t> mLevels;
+		
+		/* children are contiguous in breadth first order */
+		std::vector<size_t> mChildBegin;
+		std::vector<size_t> mChildEnd;
+		
+		std::unordered_map<const Node*, size_t> mIndices;
+		
+		/* evaluated matrices */
+		std::vector<Matrix> mLocal;
+		std::vector<Matrix> mWorld;
+		
+		/* pending edits */
+		enum DirtyState { CLEAN, DIRTY_WORLD, DIRTY_LOCAL };
+		
+		std::vector<unsigned char> mDirty;
+		std::vector<size_t> mDirtyList;
+		
+		ThreadPool* mPool;
+		
+		
+		/* evaluation methods */
+		void flatten (const VisualScene* scene);
+		void propagate (size_t begin, size_t end);
+		void propagateSubtree (size_t root);
+		
+		void markDirty (size_t index, DirtyState state);
+		size_t checkIndex (const Node* node) const;
+	};
+
+}
+
+
+#endif /* COLLADA_PARSER_TRANSFORM_EVALUATOR_H_ */
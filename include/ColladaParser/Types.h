@@ -40,6 +40,12 @@ namespace ColladaParser
 	{
 		float u,v;
 	};
+	
+	
+	struct COLLADA_PARSER_API Bounds
+	{
+		Vector min, max;
+	};
 
 }
 
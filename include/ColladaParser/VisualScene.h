@@ -24,7 +24,10 @@ THE SOFTWARE.
 #define COLLADA_PARSER_VISUAL_SCENE_H_
 
 
+#include <memory>
+
 #include <ColladaParser/Config.h>
+#include <ColladaParser/Allocator.h>
 #include <ColladaParser/Node.h>
 
 
@@ -42,7 +45,7 @@ namespace ColladaParser
 	 * well as any transformations it may have. It encapsulates data
 	 * from the '<visual_scene>' element of the Collada specification.
 	 */
-	class COLLADA_PARSER_API VisualScene
+	class COLLADA_PARSER_API VisualScene : public Allocated
 	{
 	public:
 		/**
@@ -52,6 +55,22 @@ namespace ColladaParser
 		 */
 		VisualScene (ticpp::Element* element);
 		
+		/**
+		 * Constructor.
+		 * Reads the 'visual_scene' element when its top level nodes were
+		 * parsed separately. They come before any nodes left in the element.
+		 * @param element The XML node to parse.
+		 * @param nodes The top level nodes, owned by the scene afterwards.
+		 */
+		VisualScene (ticpp::Element* element, const NodeList& nodes);
+		
+		/**
+		 * Constructor.
+		 * Reads the scene and its node table from a binary cache.
+		 * @param reader The cache to read from.
+		 */
+		VisualScene (CacheReader& reader);
+		
 		/**
 		 * Destructor.
 		 */
@@ -61,12 +80,12 @@ namespace ColladaParser
 		/**
 		 * The visual scene ID.
 		 */
-		std::string getID() const { return mID; }
+		const std::string& getID() const { return mID; }
 		
 		/**
 		 * The visual scene name.
 		 */
-		std::string getName() const { return mName; }
+		const std::string& getName() const { return mName; }
 		
 		
 		/**
@@ -74,15 +93,28 @@ namespace ColladaParser
 		 */
 		const NodeList& getNodes() const { return mNodes; }
 		
+		/**
+		 * Write the scene to a binary cache. The nodes are written as a
+		 * flat table in depth first order, each with its parent index.
+		 */
+		void write (CacheWriter& writer) const;
+		
 		
 	private:
+		/* holds the strings of the scene and its nodes */
+		std::shared_ptr<StringPool> mStrings;
+		
 		/* properties */
-		std::string mID;
-		std::string mName;
+		InternedString mID;
+		InternedString mName;
 		
 		NodeList mNodes;
 		
 		
+		/* free the node tree */
+		void release ();
+		
+		
 		/* parsing methods */
 		void parse (ticpp::Element* element);
 	};
@@ -1455,6 +1455,14 @@ namespace ticpp
 		@throws Exception
 		*/
 		void Parse( const std::string& xml, bool throwIfParseError = true, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+
+		/**
+		Set whether white space is condensed when this document is parsed.
+		Unlike TiXmlBase::SetCondenseWhiteSpace it only affects this document.
+
+		@param condense Whether to condense white space.
+		*/
+		void SetCondenseWhiteSpace( bool condense );
 	};
 
 	/** Wrapper around TiXmlElement */
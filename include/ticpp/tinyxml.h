@@ -49,6 +49,8 @@ distribution.
 	#endif
 #endif
 
+#include <atomic>
+
 #ifdef TIXML_USE_STL
 	#include <string>
  	#include <iostream>
@@ -230,13 +232,14 @@ public:
 	/**	The world does not agree on whether white space should be kept or
 		not. In order to make everyone happy, these global, static functions
 		are provided to set whether or not TinyXml will condense all white space
-		into a single space or not. The default is to condense. Note changing this
-		value is not thread safe.
+		into a single space or not. The default is to condense. This only sets
+		the default for documents created afterwards, each TiXmlDocument keeps
+		its own setting which can be changed with SetDocumentWhiteSpaceCondensed.
 	*/
-	static void SetCondenseWhiteSpace( bool condense )		{ condenseWhiteSpace = condense; }
+	static void SetCondenseWhiteSpace( bool condense )		{ condenseWhiteSpace.store( condense ); }
 
 	/// Return the current white space setting.
-	static bool IsWhiteSpaceCondensed()						{ return condenseWhiteSpace; }
+	static bool IsWhiteSpaceCondensed()						{ return condenseWhiteSpace.load(); }
 
 	/** Return the position, in the original source file, of this node or attribute.
 		The row and column are 1-based. (That is the first row and first column is
@@ -332,7 +335,8 @@ protected:
 									bool ignoreWhiteSpace,		// whether to keep the white space
 									const char* endTag,			// what ends this text
 									bool ignoreCase,			// whether to ignore case in the end tag
-									TiXmlEncoding encoding );	// the current encoding
+									TiXmlEncoding encoding,		// the current encoding
+									bool condense );			// the document white space setting
 
 	// If an entity has been found, transform it into a character.
 	static const char* GetEntity( const char* in, char* value, int* length, TiXmlEncoding encoding );
@@ -425,7 +429,7 @@ private:
 
 	};
 	static Entity entity[ NUM_ENTITY ];
-	static bool condenseWhiteSpace;
+	static std::atomic<bool> condenseWhiteSpace;
 };
 
 
@@ -1582,6 +1586,10 @@ public:
 
 	int TabSize() const	{ return tabsize; }
 
+	/// Whether this document condenses white space when parsing.
+	void SetDocumentWhiteSpaceCondensed( bool condense )	{ documentCondenseWhiteSpace = condense; }
+	bool IsDocumentWhiteSpaceCondensed() const			{ return documentCondenseWhiteSpace; }
+
 	/** If you have handled the error, it can be reset with this call. The error
 		state is automatically cleared if you Parse a new XML block.
 	*/
@@ -1629,6 +1637,7 @@ private:
 	int tabsize;
 	TiXmlCursor errorLocation;
 	bool useMicrosoftBOM;		// the UTF-8 BOM were found when read. Note this, and try to write.
+	bool documentCondenseWhiteSpace;	// per document copy of the global default
 };
 
 
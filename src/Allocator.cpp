@@ -0,0 +1,279 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+
+#include "Allocator.h"
+
+#include <new>
+#include <algorithm>
+
+
+namespace ColladaParser
+{
+
+	/* plain new and delete */
+	class HeapAllocator : public Allocator
+	{
+	public:
+		void* allocate (size_t size, size_t) { return ::operator new (size); }
+		void deallocate (void* data, size_t) { ::operator delete (data); }
+	};
+	
+	
+	static thread_local Allocator* sCurrent = 0;
+	
+	
+	
+	/* current or heap allocator */
+	Allocator* Allocator::getCurrent ()
+	{
+		return sCurrent ? sCurrent : getHeap ();
+	}
+	
+	
+	/* heap allocator, never released */
+	Allocator* Allocator::getHeap ()
+	{
+		static HeapAllocator* heap = new HeapAllocator ();
+		return heap;
+	}
+	
+	
+	
+	/* make the allocator current */
+	Allocator::Scope::Scope (Allocator* allocator) : mPrevious(sCurrent)
+	{
+		sCurrent = allocator;
+	}
+	
+	
+	/* restore the previous allocator */
+	Allocator::Scope::~Scope ()
+	{
+		sCurrent = mPrevious;
+	}
+	
+	
+	
+	
+	/* constructor */
+	ArenaAllocator::ArenaAllocator (size_t blockSize)
+	: mBlockSize (blockSize),
+	  mSize (0),
+	  mNext (0),
+	  mEnd (0)
+	{
+		std::fill (mFree, mFree + SIZE_CLASSES, static_cast<FreePiece*> (0));
+	}
+	
+	
+	/* destructor */
+	ArenaAllocator::~ArenaAllocator ()
+	{
+		release ();
+	}
+	
+	
+	
+	/* reuse a piece given back or take the next aligned piece of the
+	 * last block */
+	void* ArenaAllocator::allocate (size_t size, size_t alignment)
+	{
+		std::lock_guard<std::mutex> lock (mMutex);
+		
+		if (size > SMALL_LIMIT)
+			return allocateLarge (size, alignment);
+		
+		size = size > 0 ? (size + GRAIN - 1) / GRAIN * GRAIN : GRAIN;
+		FreePiece*& list = mFree[size / GRAIN - 1];
+		
+		/* pieces on the free lists are only aligned to the grain */
+		if (list && alignment <= GRAIN)
+		{
+			FreePiece* piece = list;
+			list = piece->next;
+			return piece;
+		}
+		
+		
+		size_t padding = mNext ? (alignment - reinterpret_cast<size_t> (mNext) % alignment) % alignment : 0;
+		
+		
+		/* start a new block */
+		if (!mNext || padding + size > size_t (mEnd - mNext))
+		{
+			size_t bytes = std::max (mBlockSize, size + alignment);
+			char* block = static_cast<char*> (::operator new (bytes));
+			
+			mBlocks.push_back (block);
+			mSize += bytes;
+			
+			mNext = block;
+			mEnd = block + bytes;
+			
+			padding = (alignment - reinterpret_cast<size_t> (mNext) % alignment) % alignment;
+		}
+		
+		void* data = mNext + padding;
+		mNext += padding + size;
+		
+		return data;
+	}
+	
+	
+	
+	/* a large piece straight from the heap */
+	void* ArenaAllocator::allocateLarge (size_t size, size_t alignment)
+	{
+		LargePiece piece;
+		piece.size = alignment > GRAIN ? size + alignment : size;
+		piece.block = static_cast<char*> (::operator new (piece.size));
+		
+		char* data = piece.block;
+		
+		if (alignment > GRAIN)
+			data += (alignment - reinterpret_cast<size_t> (data) % alignment) % alignment;
+		
+		try
+		{
+			mLarge.insert (std::make_pair (data, piece));
+		}
+		catch (...)
+		{
+			::operator delete (piece.block);
+			throw;
+		}
+		
+		mSize += piece.size;
+		return data;
+	}
+	
+	
+	
+	/* free large pieces now and keep small ones for reuse */
+	void ArenaAllocator::deallocate (void* data, size_t size)
+	{
+		if (!data)
+			return;
+		
+		std::lock_guard<std::mutex> lock (mMutex);
+		
+		if (size > SMALL_LIMIT)
+		{
+			std::unordered_map<void*, LargePiece>::iterator iter = mLarge.find (data);
+			
+			if (iter != mLarge.end())
+			{
+				mSize -= iter->second.size;
+				::operator delete (iter->second.block);
+				mLarge.erase (iter);
+			}
+			
+			return;
+		}
+		
+		size = size > 0 ? (size + GRAIN - 1) / GRAIN * GRAIN : GRAIN;
+		
+		FreePiece* piece = static_cast<FreePiece*> (data);
+		piece->next = mFree[size / GRAIN - 1];
+		mFree[size / GRAIN - 1] = piece;
+	}
+	
+	
+	
+	/* free every block at once */
+	void ArenaAllocator::release ()
+	{
+		std::lock_guard<std::mutex> lock (mMutex);
+		
+		for (size_t i = 0; i < mBlocks.size(); i++)
+			::operator delete (mBlocks[i]);
+		
+		std::unordered_map<void*, LargePiece>::iterator iter;
+		
+		for (iter = mLarge.begin(); iter != mLarge.end(); ++iter)
+			::operator delete (iter->second.block);
+		
+		mBlocks.clear ();
+		mLarge.clear ();
+		std::fill (mFree, mFree + SIZE_CLASSES, static_cast<FreePiece*> (0));
+		
+		mSize = 0;
+		mNext = 0;
+		mEnd = 0;
+	}
+	
+	
+	/* bytes held */
+	size_t ArenaAllocator::getSize () const
+	{
+		std::lock_guard<std::mutex> lock (mMutex);
+		return mSize;
+	}
+	
+	
+	
+	
+	/* allocation header, which remembers where an object came from */
+	struct Header
+	{
+		Allocator* allocator;
+		size_t size;
+	};
+	
+	/* keeps objects after the header aligned */
+	static const size_t HEADER_SIZE = alignof (std::max_align_t);
+	static_assert (sizeof (Header) <= HEADER_SIZE, "allocation header doesn't fit");
+	
+	
+	
+	/* allocate from the current allocator */
+	void* Allocated::operator new (size_t size)
+	{
+		Allocator* allocator = Allocator::getCurrent ();
+		
+		size += HEADER_SIZE;
+		char* data = static_cast<char*> (allocator->allocate (size, HEADER_SIZE));
+		
+		if (!data)
+			throw std::bad_alloc ();
+		
+		Header* header = reinterpret_cast<Header*> (data);
+		header->allocator = allocator;
+		header->size = size;
+		
+		return data + HEADER_SIZE;
+	}
+	
+	
+	/* give back to the allocator it came from */
+	void Allocated::operator delete (void* data)
+	{
+		if (!data)
+			return;
+		
+		Header* header = reinterpret_cast<Header*> (static_cast<char*> (data) - HEADER_SIZE);
+		header->allocator->deallocate (header, header->size);
+	}
+
+}
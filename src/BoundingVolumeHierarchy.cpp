@@ -0,0 +1,650 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "BoundingVolumeHierarchy.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+
+#include "Geometry.h"
+#include "ThreadPool.h"
+#include "TransformEvaluator.h"
+
+
+namespace ColladaParser
+{
+
+	/* tree building parameters */
+	static const unsigned int BIN_COUNT = 16;
+	static const unsigned int MAX_LEAF_SIZE = 4;
+	static const unsigned int PARALLEL_DEPTH = 6;
+	static const unsigned int PARALLEL_MIN_SIZE = 1024;
+	
+	
+	
+	
+	/* bounds helpers */
+	static Bounds emptyBounds ()
+	{
+		Bounds bounds;
+		bounds.min.x = bounds.min.y = bounds.min.z =  std::numeric_limits<float>::max ();
+		bounds.max.x = bounds.max.y = bounds.max.z = -std::numeric_limits<float>::max ();
+		return bounds;
+	}
+	
+	
+	static void grow (Bounds& bounds, const Bounds& other)
+	{
+		bounds.min.x = std::min (bounds.min.x, other.min.x);
+		bounds.min.y = std::min (bounds.min.y, other.min.y);
+		bounds.min.z = std::min (bounds.min.z, other.min.z);
+		
+		bounds.max.x = std::max (bounds.max.x, other.max.x);
+		bounds.max.y = std::max (bounds.max.y, other.max.y);
+		bounds.max.z = std::max (bounds.max.z, other.max.z);
+	}
+	
+	
+	static void grow (Bounds& bounds, const Vector& point)
+	{
+		bounds.min.x = std::min (bounds.min.x, point.x);
+		bounds.min.y = std::min (bounds.min.y, point.y);
+		bounds.min.z = std::min (bounds.min.z, point.z);
+		
+		bounds.max.x = std::max (bounds.max.x, point.x);
+		bounds.max.y = std::max (bounds.max.y, point.y);
+		bounds.max.z = std::max (bounds.max.z, point.z);
+	}
+	
+	
+	static float area (const Bounds& bounds)
+	{
+		float x = bounds.max.x - bounds.min.x;
+		float y = bounds.max.y - bounds.min.y;
+		float z = bounds.max.z - bounds.min.z;
+		
+		if (x < 0 || y < 0 || z < 0)
+			return 0;
+		
+		return 2.0f * (x * y + y * z + z * x);
+	}
+	
+	
+	static float centre (const Bounds& bounds, int axis)
+	{
+		const float* min = &bounds.min.x;
+		const float* max = &bounds.max.x;
+		return (min[axis] + max[axis]) * 0.5f;
+	}
+	
+	
+	/* transform bounds by centre and absolute extents */
+	static Bounds transform (const Matrix& matrix, const Bounds& bounds)
+	{
+		if (bounds.min.x > bounds.max.x)
+			return bounds;
+		
+		Vector c, e;
+		c.x = (bounds.min.x + bounds.max.x) * 0.5f;
+		c.y = (bounds.min.y + bounds.max.y) * 0.5f;
+		c.z = (bounds.min.z + bounds.max.z) * 0.5f;
+		
+		e.x = (bounds.max.x - bounds.min.x) * 0.5f;
+		e.y = (bounds.max.y - bounds.min.y) * 0.5f;
+		e.z = (bounds.max.z - bounds.min.z) * 0.5f;
+		
+		Vector wc = matrix.transformPoint (c);
+		Vector we;
+		
+		we.x = std::fabs (matrix(0,0)) * e.x + std::fabs (matrix(0,1)) * e.y + std::fabs (matrix(0,2)) * e.z;
+		we.y = std::fabs (matrix(1,0)) * e.x + std::fabs (matrix(1,1)) * e.y + std::fabs (matrix(1,2)) * e.z;
+		we.z = std::fabs (matrix(2,0)) * e.x + std::fabs (matrix(2,1)) * e.y + std::fabs (matrix(2,2)) * e.z;
+		
+		Bounds result;
+		result.min.x = wc.x - we.x; result.max.x = wc.x + we.x;
+		result.min.y = wc.y - we.y; result.max.y = wc.y + we.y;
+		result.min.z = wc.z - we.z; result.max.z = wc.z + we.z;
+		return result;
+	}
+	
+	
+	
+	
+	/* constructor */
+	BoundingVolumeHierarchy::BoundingVolumeHierarchy (const TransformEvaluator* transforms, unsigned int threads)
+	: mTransforms (transforms),
+	  mVolumeCount (0),
+	  mPool (new ThreadPool (threads))
+	{
+		gather ();
+		build ();
+	}
+	
+	
+	/* destructor */
+	BoundingVolumeHierarchy::~BoundingVolumeHierarchy ()
+	{
+		delete mPool;
+	}
+	
+	
+	
+	
+	/* collect geometry instances and their local bounds */
+	void BoundingVolumeHierarchy::gather ()
+	{
+		std::unordered_map<const Geometry*, size_t> unique;
+		std::vector<const Geometry*> geometries;
+		
+		
+		for (size_t i = 0; i < mTransforms->getNodeCount(); i++)
+		{
+			const GeometryInstanceList& list = mTransforms->getNode(i)->getGeometries ();
+			
+			for (size_t g = 0; g < list.size(); g++)
+			{
+				/* unresolved urls have nothing to place */
+				Geometry* geometry = list[g]->getGeometry ();
+				
+				if (!geometry)
+					continue;
+				
+				Instance instance;
+				instance.node = mTransforms->getNode (i);
+				instance.geometry = list[g];
+				instance.transform = i;
+				
+				if (unique.insert (std::make_pair (geometry, geometries.size())).second)
+					geometries.push_back (geometry);
+				
+				mInstances.push_back (instance);
+			}
+		}
+		
+		
+		/* each geometry is only measured once */
+		std::vector<Bounds> bounds (geometries.size());
+		
+		mPool->parallelFor (geometries.size(), 16, [&] (size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				bounds[i] = geometries[i]->computeBounds ();
+		});
+		
+		for (size_t i = 0; i < mInstances.size(); i++)
+			mInstances[i].local = bounds[unique[mInstances[i].geometry->geometry]];
+	}
+	
+	
+	
+	
+	/* move local bounds into the world */
+	void BoundingVolumeHierarchy::placeInstances ()
+	{
+		mPool->parallelFor (mInstances.size(), 1024, [this] (size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				Instance& instance = mInstances[i];
+				instance.world = transform (mTransforms->getWorldMatrix (instance.transform), instance.local);
+			}
+		});
+	}
+	
+	
+	
+	
+	/* build the tree */
+	void BoundingVolumeHierarchy::build ()
+	{
+		placeInstances ();
+		
+		unsigned int count = mInstances.size ();
+		
+		mOrder.resize (count);
+		for (unsigned int i = 0; i < count; i++)
+			mOrder[i] = i;
+		
+		
+		/* a binary tree never has more than 2n - 1 nodes */
+		mVolumes.resize (std::max (1u, 2 * count));
+		mVolumeCount = 1;
+		
+		split (0, 0, count, 0);
+		mVolumes.resize (mVolumeCount);
+	}
+	
+	
+	
+	
+	/* recursively split a range of instances */
+	void BoundingVolumeHierarchy::split (unsigned int volume, unsigned int begin, unsigned int end, unsigned int depth)
+	{
+		Volume& node = mVolumes[volume];
+		unsigned int count = end - begin;
+		
+		
+		/* node and centroid bounds */
+		Bounds bounds = emptyBounds ();
+		Bounds centroids = emptyBounds ();
+		
+		for (unsigned int i = begin; i < end; i++)
+		{
+			const Bounds& world = mInstances[mOrder[i]].world;
+			grow (bounds, world);
+			
+			Vector c;
+			c.x = centre (world, 0);
+			c.y = centre (world, 1);
+			c.z = centre (world, 2);
+			grow (centroids, c);
+		}
+		
+		node.bounds = bounds;
+		node.first = begin;
+		node.count = count;
+		
+		if (count <= 2)
+			return;
+		
+		
+		/* split along the widest centroid axis */
+		float extent[3] = {
+			centroids.max.x - centroids.min.x,
+			centroids.max.y - centroids.min.y,
+			centroids.max.z - centroids.min.z };
+		
+		int axis = 0;
+		if (extent[1] > extent[axis]) axis = 1;
+		if (extent[2] > extent[axis]) axis = 2;
+		
+		float minimum = (&centroids.min.x)[axis];
+		unsigned int mid = begin;
+		
+		
+		if (extent[axis] > 0)
+		{
+			/* bin the centroids */
+			unsigned int binCount[BIN_COUNT] = {0};
+			Bounds binBounds[BIN_COUNT];
+			
+			for (unsigned int b = 0; b < BIN_COUNT; b++)
+				binBounds[b] = emptyBounds ();
+			
+			float scale = BIN_COUNT / extent[axis];
+			
+			for (unsigned int i = begin; i < end; i++)
+			{
+				const Bounds& world = mInstances[mOrder[i]].world;
+				unsigned int b = std::min (BIN_COUNT - 1, (unsigned int) ((centre (world, axis) - minimum) * scale));
+				
+				binCount[b]++;
+				grow (binBounds[b], world);
+			}
+			
+			
+			/* sweep from the right to get the right hand costs */
+			float rightArea[BIN_COUNT];
+			unsigned int rightCount[BIN_COUNT];
+			
+			Bounds sweep = emptyBounds ();
+			unsigned int total = 0;
+			
+			for (unsigned int b = BIN_COUNT - 1; b > 0; b--)
+			{
+				grow (sweep, binBounds[b]);
+				total += binCount[b];
+				
+				rightArea[b] = area (sweep);
+				rightCount[b] = total;
+			}
+			
+			
+			/* sweep from the left and find the cheapest split */
+			float bestCost = std::numeric_limits<float>::max ();
+			unsigned int bestSplit = 0;
+			
+			sweep = emptyBounds ();
+			total = 0;
+			
+			for (unsigned int b = 1; b < BIN_COUNT; b++)
+			{
+				grow (sweep, binBounds[b - 1]);
+				total += binCount[b - 1];
+				
+				float cost = total * area (sweep) + rightCount[b] * rightArea[b];
+				
+				if (total > 0 && rightCount[b] > 0 && cost < bestCost)
+				{
+					bestCost = cost;
+					bestSplit = b;
+				}
+			}
+			
+			
+			/* a leaf is cheaper than splitting */
+			if (count <= MAX_LEAF_SIZE && bestCost >= count * area (bounds))
+				return;
+			
+			
+			if (bestSplit > 0)
+			{
+				unsigned int* split = std::partition (&mOrder[begin], &mOrder[0] + end,
+						[&] (unsigned int index)
+						{
+							const Bounds& world = mInstances[index].world;
+							unsigned int b = std::min (BIN_COUNT - 1, (unsigned int) ((centre (world, axis) - minimum) * scale));
+							return b < bestSplit;
+						});
+				
+				mid = split - &mOrder[0];
+			}
+		}
+		
+		
+		/* coincident centroids can't be binned so halve the range */
+		if (mid == begin || mid == end)
+		{
+			if (count <= MAX_LEAF_SIZE)
+				return;
+			
+			mid = begin + count / 2;
+		}
+		
+		
+		/* children are allocated as a pair */
+		unsigned int children = mVolumeCount.fetch_add (2);
+		
+		node.first = children;
+		node.count = 0;
+		
+		
+		/* the top splits are built in parallel */
+		if (depth < PARALLEL_DEPTH && count >= PARALLEL_MIN_SIZE)
+		{
+			mPool->parallelFor (2, 1, [=] (size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; i++)
+				{
+					if (i == 0) split (children,     begin, mid, depth + 1);
+					else        split (children + 1, mid,   end, depth + 1);
+				}
+			});
+		}
+		else
+		{
+			split (children,     begin, mid, depth + 1);
+			split (children + 1, mid,   end, depth + 1);
+		}
+	}
+	
+	
+	
+	
+	/* refit bounds bottom up */
+	void BoundingVolumeHierarchy::refit ()
+	{
+		placeInstances ();
+		
+		
+		/* children are always allocated after their parents */
+		for (size_t v = mVolumes.size(); v > 0; v--)
+		{
+			Volume& volume = mVolumes[v - 1];
+			volume.bounds = emptyBounds ();
+			
+			if (volume.count > 0)
+			{
+				for (unsigned int i = volume.first; i < volume.first + volume.count; i++)
+					grow (volume.bounds, mInstances[mOrder[i]].world);
+			}
+			else if (!mInstances.empty())
+			{
+				grow (volume.bounds, mVolumes[volume.first].bounds);
+				grow (volume.bounds, mVolumes[volume.first + 1].bounds);
+			}
+		}
+	}
+	
+	
+	
+	
+	/* scene bounds */
+	Bounds BoundingVolumeHierarchy::getBounds () const
+	{
+		return mVolumes.empty() ? emptyBounds () : mVolumes[0].bounds;
+	}
+	
+	
+	
+	
+	/* slab test returning the entry distance or -1 */
+	static float hit (const Bounds& bounds, const Vector& origin, const Vector& inverse, float length)
+	{
+		const float* min = &bounds.min.x;
+		const float* max = &bounds.max.x;
+		const float* o = &origin.x;
+		const float* inv = &inverse.x;
+		
+		float near = 0;
+		float far = length;
+		
+		for (int axis = 0; axis < 3; axis++)
+		{
+			/* parallel to the slab so it either always or never overlaps */
+			if (inv[axis] == 0)
+			{
+				if (o[axis] < min[axis] || o[axis] > max[axis])
+					return -1;
+				
+				continue;
+			}
+			
+			float t1 = (min[axis] - o[axis]) * inv[axis];
+			float t2 = (max[axis] - o[axis]) * inv[axis];
+			
+			near = std::max (near, std::min (t1, t2));
+			far  = std::min (far,  std::max (t1, t2));
+		}
+		
+		return near <= far ? near : -1;
+	}
+	
+	
+	
+	
+	/* trace a single ray */
+	RayHit BoundingVolumeHierarchy::cast (const Ray& ray) const
+	{
+		RayHit result;
+		result.instance = -1;
+		result.distance = ray.length;
+		
+		if (mInstances.empty())
+			return result;
+		
+		
+		/* axes the ray doesn't move along are flagged with a zero */
+		Vector inverse;
+		inverse.x = ray.direction.x != 0 ? 1.0f / ray.direction.x : 0;
+		inverse.y = ray.direction.y != 0 ? 1.0f / ray.direction.y : 0;
+		inverse.z = ray.direction.z != 0 ? 1.0f / ray.direction.z : 0;
+		
+		
+		std::vector<unsigned int> stack;
+		stack.reserve (64);
+		
+		if (hit (mVolumes[0].bounds, ray.origin, inverse, result.distance) >= 0)
+			stack.push_back (0);
+		
+		
+		while (!stack.empty())
+		{
+			const Volume& volume = mVolumes[stack.back()];
+			stack.pop_back ();
+			
+			
+			/* closest instance in the leaf */
+			if (volume.count > 0)
+			{
+				for (unsigned int i = volume.first; i < volume.first + volume.count; i++)
+				{
+					float distance = hit (mInstances[mOrder[i]].world, ray.origin, inverse, result.distance);
+					
+					if (distance >= 0 && (distance < result.distance || result.instance < 0))
+					{
+						result.instance = mOrder[i];
+						result.distance = distance;
+					}
+				}
+				
+				continue;
+			}
+			
+			
+			/* visit the nearer child first */
+			float left  = hit (mVolumes[volume.first].bounds,     ray.origin, inverse, result.distance);
+			float right = hit (mVolumes[volume.first + 1].bounds, ray.origin, inverse, result.distance);
+			
+			if (left >= 0 && right >= 0)
+			{
+				if (left < right)
+				{
+					stack.push_back (volume.first + 1);
+					stack.push_back (volume.first);
+				}
+				else
+				{
+					stack.push_back (volume.first);
+					stack.push_back (volume.first + 1);
+				}
+			}
+			else if (left  >= 0) stack.push_back (volume.first);
+			else if (right >= 0) stack.push_back (volume.first + 1);
+		}
+		
+		return result;
+	}
+	
+	
+	/* trace a batch of rays */
+	void BoundingVolumeHierarchy::intersect (const std::vector<Ray>& rays, std::vector<RayHit>& hits) const
+	{
+		hits.resize (rays.size());
+		
+		mPool->parallelFor (rays.size(), 256, [&] (size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				hits[i] = cast (rays[i]);
+		});
+	}
+	
+	
+	
+	
+	/* whether the bounds lie entirely outside a plane */
+	static bool outside (const Bounds& bounds, const Plane& plane)
+	{
+		/* the corner furthest along the plane normal */
+		Vector corner;
+		corner.x = plane.normal.x >= 0 ? bounds.max.x : bounds.min.x;
+		corner.y = plane.normal.y >= 0 ? bounds.max.y : bounds.min.y;
+		corner.z = plane.normal.z >= 0 ? bounds.max.z : bounds.min.z;
+		
+		return plane.normal.x * corner.x + plane.normal.y * corner.y +
+				plane.normal.z * corner.z + plane.distance < 0;
+	}
+	
+	
+	static bool outside (const Bounds& bounds, const Frustum& frustum)
+	{
+		for (int p = 0; p < 6; p++)
+		{
+			if (outside (bounds, frustum.planes[p]))
+				return true;
+		}
+		
+		return false;
+	}
+	
+	
+	
+	
+	/* cull a single frustum */
+	void BoundingVolumeHierarchy::cull (const Frustum& frustum, std::vector<size_t>& instances) const
+	{
+		instances.clear ();
+		
+		if (mInstances.empty())
+			return;
+		
+		
+		std::vector<unsigned int> stack (1, 0);
+		
+		while (!stack.empty())
+		{
+			const Volume& volume = mVolumes[stack.back()];
+			stack.pop_back ();
+			
+			if (outside (volume.bounds, frustum))
+				continue;
+			
+			
+			if (volume.count > 0)
+			{
+				for (unsigned int i = volume.first; i < volume.first + volume.count; i++)
+				{
+					if (!outside (mInstances[mOrder[i]].world, frustum))
+						instances.push_back (mOrder[i]);
+				}
+			}
+			else
+			{
+				stack.push_back (volume.first);
+				stack.push_back (volume.first + 1);
+			}
+		}
+	}
+	
+	
+	void BoundingVolumeHierarchy::intersect (const Frustum& frustum, std::vector<size_t>& instances) const
+	{
+		cull (frustum, instances);
+	}
+	
+	
+	/* cull a batch of frusta */
+	void BoundingVolumeHierarchy::intersect (const std::vector<Frustum>& frusta, std::vector< std::vector<size_t> >& instances) const
+	{
+		instances.resize (frusta.size());
+		
+		mPool->parallelFor (frusta.size(), 1, [&] (size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				cull (frusta[i], instances[i]);
+		});
+	}
+
+}
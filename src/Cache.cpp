@@ -0,0 +1,262 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+
+#include "Cache.h"
+
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "MappedFile.h"
+
+
+namespace ColladaParser
+{
+
+	static const char CACHE_MAGIC[8] = "COLLBIN";
+	
+	
+	
+	/* constructor */
+	CacheWriter::CacheWriter (const std::string& file)
+	: mFile (file),
+	  mTemporary (file + ".tmp"),
+	  mPosition (0)
+	{
+		mStream.open (mTemporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		
+		if (!mStream)
+		{
+			std::string error = "Failed to write cache file '" + mTemporary + "'";
+			throw std::runtime_error (error.c_str());
+		}
+		
+		/* the header is filled in once everything is written */
+		pad (sizeof (CacheHeader));
+	}
+	
+	
+	/* destructor */
+	CacheWriter::~CacheWriter ()
+	{
+		/* unfinished caches are thrown away */
+		if (mStream.is_open())
+		{
+			mStream.close ();
+			std::remove (mTemporary.c_str());
+		}
+	}
+	
+	
+	
+	/* write raw bytes */
+	void CacheWriter::write (const void* data, size_t size)
+	{
+		mStream.write (static_cast<const char*> (data), size);
+		mPosition += size;
+	}
+	
+	
+	/* write zeros up to the given position */
+	void CacheWriter::pad (uint64_t position)
+	{
+		static const char zeros[64] = {0};
+		
+		while (mPosition < position)
+		{
+			size_t size = std::min<uint64_t> (position - mPosition, sizeof (zeros));
+			write (zeros, size);
+		}
+	}
+	
+	
+	/* write a string table index */
+	void CacheWriter::writeString (const std::string& text)
+	{
+		std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> result;
+		result = mStringIndex.insert (std::make_pair (text, uint32_t (mStrings.size())));
+		
+		if (result.second)
+			mStrings.push_back (&result.first->first);
+		
+		write (result.first->second);
+	}
+	
+	
+	/* write an aligned array */
+	void CacheWriter::writeArray (const void* data, size_t size)
+	{
+		uint64_t length = size;
+		std::unordered_map<const void*, uint64_t>::iterator iter = mArrays.find (data);
+		
+		/* refer back to the earlier copy */
+		if (iter != mArrays.end())
+		{
+			write (length);
+			write (iter->second);
+			return;
+		}
+		
+		uint64_t offset = (mPosition + 2 * sizeof (uint64_t) + 15) & ~uint64_t (15);
+		
+		write (length);
+		write (offset);
+		pad (offset);
+		write (data, size);
+		
+		if (data)
+			mArrays.insert (std::make_pair (data, offset));
+	}
+	
+	
+	
+	/* write the string table and header */
+	void CacheWriter::finish (CacheHeader& header)
+	{
+		pad ((mPosition + 7) & ~uint64_t (7));
+		
+		std::memcpy (header.magic, CACHE_MAGIC, sizeof (header.magic));
+		header.version = CacheHeader::VERSION;
+		header.strings = mPosition;
+		header.stringCount = mStrings.size();
+		
+		for (size_t i = 0; i < mStrings.size(); i++)
+		{
+			uint32_t length = mStrings[i]->size();
+			write (length);
+			write (mStrings[i]->data(), length);
+		}
+		
+		mStream.seekp (0);
+		mStream.write (reinterpret_cast<const char*> (&header), sizeof (header));
+		mStream.close ();
+		
+		if (!mStream)
+		{
+			std::remove (mTemporary.c_str());
+			
+			std::string error = "Failed to write cache file '" + mTemporary + "'";
+			throw std::runtime_error (error.c_str());
+		}
+		
+		
+		/* replace the old cache in one step */
+		std::remove (mFile.c_str());
+		
+		if (std::rename (mTemporary.c_str(), mFile.c_str()) != 0)
+		{
+			std::remove (mTemporary.c_str());
+			
+			std::string error = "Failed to write cache file '" + mFile + "'";
+			throw std::runtime_error (error.c_str());
+		}
+	}
+	
+	
+	
+	
+	/* constructor */
+	CacheReader::CacheReader (const std::shared_ptr<MappedFile>& file)
+	: mFile (file),
+	  mPosition (0)
+	{
+		if (mFile->getSize() < sizeof (CacheHeader))
+			throw std::runtime_error ("Invalid cache file: Truncated header");
+		
+		std::memcpy (&mHeader, mFile->getData(), sizeof (mHeader));
+		
+		if (std::memcmp (mHeader.magic, CACHE_MAGIC, sizeof (mHeader.magic)) != 0 ||
+		    mHeader.version != CacheHeader::VERSION)
+			throw std::runtime_error ("Invalid cache file: Unknown format");
+		
+		
+		/* string table */
+		if (mHeader.stringCount > mFile->getSize())
+			throw std::runtime_error ("Invalid cache file: Truncated data");
+		
+		mPosition = mHeader.strings;
+		mStrings.resize (mHeader.stringCount);
+		
+		for (size_t i = 0; i < mStrings.size(); i++)
+		{
+			uint32_t length = read<uint32_t> ();
+			check (mPosition, length);
+			
+			mStrings[i].assign (mFile->getData() + mPosition, length);
+			mPosition += length;
+		}
+		
+		mPosition = sizeof (CacheHeader);
+	}
+	
+	
+	
+	/* fail on reads past the end of the file */
+	void CacheReader::check (uint64_t position, uint64_t size) const
+	{
+		if (position > mFile->getSize() || size > mFile->getSize() - position)
+			throw std::runtime_error ("Invalid cache file: Truncated data");
+	}
+	
+	
+	/* read raw bytes */
+	void CacheReader::read (void* data, size_t size)
+	{
+		check (mPosition, size);
+		
+		std::memcpy (data, mFile->getData() + mPosition, size);
+		mPosition += size;
+	}
+	
+	
+	/* read a string table index */
+	const std::string& CacheReader::readString ()
+	{
+		uint32_t index = read<uint32_t> ();
+		
+		if (index >= mStrings.size())
+			throw std::runtime_error ("Invalid cache file: Unknown string");
+		
+		return mStrings[index];
+	}
+	
+	
+	/* read an aligned array in place */
+	const void* CacheReader::readArray (size_t& size)
+	{
+		uint64_t length = read<uint64_t> ();
+		uint64_t offset = read<uint64_t> ();
+		
+		check (offset, length);
+		
+		/* skip data stored inline, earlier arrays are referred back to */
+		if (offset >= mPosition)
+			mPosition = offset + length;
+		
+		size = length;
+		return mFile->getData() + offset;
+	}
+
+}
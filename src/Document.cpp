@@ -22,14 +22,34 @@ THE SOFTWARE.
 
 #include "Document.h"
 
+#include <deque>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/stat.h>
 #include <ticpp/ticpp.h>
 
+#include "Transform.h"
+#include "MappedFile.h"
+#include "Cache.h"
+#include "Progress.h"
+#include "Scanner.h"
+#include "ThreadPool.h"
+
 
 namespace ColladaParser
 {
 
 	/* constructor */
-	Document::Document (const std::string &file) : mFile(file)
+	Document::Document (const std::string &file)
+	: mFile(file),
+	  mLazy(false),
+	  mDeduplicate(false),
+	  mCondenseWhiteSpace(true),
+	  mThreads(1),
+	  mCancelled(false),
+	  mStrings(std::make_shared<StringPool> ()),
+	  mAllocator(std::make_shared<ArenaAllocator> ()),
+	  mSource(0)
 	{
 	}
 	
@@ -37,6 +57,392 @@ namespace ColladaParser
 	/* destructor */
 	Document::~Document ()
 	{
+		release ();
+	}
+	
+	
+	
+	
+	/* add a parsed element */
+	template <typename T>
+	void Document::add (Library<T>& library, T* object)
+	{
+		library.index.insert (std::make_pair (object->getID(), object));
+		library.objects.push_back (object);
+		
+		MemoryCounter counter;
+		counter.add (object);
+		mMemory.allocate (counter.getStats());
+	}
+	
+	
+	/* add an element to parse later */
+	template <typename T>
+	void Document::add (Library<T>& library, size_t begin, size_t end, const std::string& id, const std::string& text)
+	{
+		typename Library<T>::Fragment fragment;
+		fragment.begin = begin;
+		fragment.end = end;
+		fragment.object = 0;
+		fragment.published = false;
+		fragment.text = text;
+		
+		mMemory.allocate (MEMORY_TEXT, text.size());
+		
+		library.pending.insert (std::make_pair (id, library.fragments.size()));
+		library.fragments.push_back (fragment);
+		library.complete = false;
+	}
+	
+	
+	
+	/* construct an element from its fragment */
+	template <typename T>
+	T* Document::parse (const typename Library<T>::Fragment& fragment) const
+	{
+		ProgressMonitor::check ();
+		StringPool::Scope scope (mStrings);
+		Allocator::Scope allocator (mAllocator.get());
+		MemoryTracker::Scope memory (&mMemory);
+		
+		size_t size = fragment.text.empty() ? fragment.end - fragment.begin : fragment.text.size();
+		T* object;
+		
+		{
+			MemoryTracker::Hold dom (&mMemory, MEMORY_DOM, MemoryTracker::estimateDOM (size));
+			ticpp::Document doc;
+			doc.SetCondenseWhiteSpace (mCondenseWhiteSpace);
+			
+			if (fragment.text.empty())
+				doc.Parse (std::string (mSource->getData() + fragment.begin, size));
+			else
+				doc.Parse (fragment.text);
+			
+			object = new T (doc.FirstChildElement());
+		}
+		
+		MemoryCounter counter;
+		counter.add (object);
+		
+		try
+		{
+			mMemory.allocate (counter.getStats());
+		}
+		catch (...)
+		{
+			delete object;
+			throw;
+		}
+		
+		if (ProgressMonitor* monitor = ProgressMonitor::getCurrent ())
+			monitor->advance (size, 1);
+		
+		return object;
+	}
+	
+	
+	/* parse an indexed element and link it into the document */
+	template <typename T>
+	T* Document::load (Library<T>& library, size_t index) const
+	{
+		typename Library<T>::Fragment& fragment = library.fragments[index];
+		
+		if (!fragment.object)
+			fragment.object = parse<T> (fragment);
+		
+		if (fragment.published)
+			return fragment.object;
+		
+		
+		T* object = fragment.object;
+		fragment.published = true;
+		
+		library.index.insert (std::make_pair (object->getID(), object));
+		library.pending.erase (object->getID());
+		
+		attach (object);
+		return object;
+	}
+	
+	
+	
+	/* an element to construct in parallel */
+	struct ParseJob
+	{
+		size_t size;
+		int library;
+		size_t fragment;
+		
+		/* top level node of a split visual scene */
+		size_t node;
+		
+		bool operator< (const ParseJob& job) const { return size > job.size; }
+	};
+	
+	
+	/* a visual scene split at its top level nodes */
+	struct SceneSplit
+	{
+		/* scene text without the nodes */
+		std::string shell;
+		
+		std::vector<std::pair<const char*, size_t> > text;
+		NodeList nodes;
+	};
+	
+	
+	static const size_t WHOLE_ELEMENT = size_t (-1);
+	
+	
+	template <typename T>
+	static void appendJobs (std::vector<ParseJob>& jobs, int library, const std::vector<T>& fragments)
+	{
+		for (size_t i = 0; i < fragments.size(); i++)
+		{
+			ParseJob job;
+			job.size = fragments[i].text.empty() ? fragments[i].end - fragments[i].begin : fragments[i].text.size();
+			job.library = library;
+			job.fragment = i;
+			job.node = WHOLE_ELEMENT;
+			
+			jobs.push_back (job);
+		}
+	}
+	
+	
+	/* scan a visual scene for its top level nodes */
+	static void splitScene (const char* data, size_t size, SceneSplit& split)
+	{
+		Scanner scanner (data, size);
+		Scanner::Element scene = scanner.getRoot ();
+		
+		std::vector<Scanner::Element> children;
+		scanner.getChildren (scene, children);
+		
+		size_t pos = scene.begin;
+		
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			if (children[i].name != "node")
+				continue;
+			
+			split.text.push_back (std::make_pair (data + children[i].begin, children[i].end - children[i].begin));
+			
+			split.shell.append (data + pos, children[i].begin - pos);
+			pos = children[i].end;
+		}
+		
+		split.shell.append (data + pos, scene.end - pos);
+		split.nodes.resize (split.text.size(), 0);
+	}
+	
+	
+	
+	/* construct every indexed element in parallel */
+	void Document::parseParallel ()
+	{
+		std::vector<ParseJob> jobs;
+		
+		appendJobs (jobs, LIBRARY_MATERIALS,  mMaterials.fragments);
+		appendJobs (jobs, LIBRARY_EFFECTS,    mEffects.fragments);
+		appendJobs (jobs, LIBRARY_GEOMETRIES, mGeometries.fragments);
+		
+		
+		/* visual scenes are split so their top level nodes are parsed
+		 * concurrently and stitched back in order afterwards */
+		std::vector<SceneSplit> splits (mVisualScenes.fragments.size());
+		
+		for (size_t i = 0; i < mVisualScenes.fragments.size(); i++)
+		{
+			const Library<VisualScene>::Fragment& fragment = mVisualScenes.fragments[i];
+			
+			if (fragment.text.empty())
+				splitScene (mSource->getData() + fragment.begin, fragment.end - fragment.begin, splits[i]);
+			else
+				splitScene (fragment.text.data(), fragment.text.size(), splits[i]);
+			
+			
+			for (size_t n = 0; n < splits[i].text.size(); n++)
+			{
+				ParseJob job;
+				job.size = splits[i].text[n].second;
+				job.library = LIBRARY_VISUAL_SCENES;
+				job.fragment = i;
+				job.node = n;
+				
+				jobs.push_back (job);
+			}
+		}
+		
+		
+		/* largest elements first so a big geometry doesn't finish last */
+		std::stable_sort (jobs.begin(), jobs.end());
+		
+		
+		/* only construct here, linking happens in document order */
+		ThreadPool pool (mThreads);
+		ProgressMonitor* monitor = ProgressMonitor::getCurrent ();
+		
+		try
+		{
+			pool.parallelFor (jobs.size(), 1, [&] (size_t begin, size_t end)
+			{
+				ProgressMonitor::Scope scope (monitor);
+				StringPool::Scope strings (mStrings);
+				Allocator::Scope allocator (mAllocator.get());
+				MemoryTracker::Scope memory (&mMemory);
+				
+				for (size_t i = begin; i < end; i++)
+				{
+					size_t n = jobs[i].fragment;
+					
+					switch (jobs[i].library)
+					{
+					case LIBRARY_MATERIALS:  mMaterials.fragments[n].object  = parse<Material> (mMaterials.fragments[n]);  break;
+					case LIBRARY_EFFECTS:    mEffects.fragments[n].object    = parse<Effect>   (mEffects.fragments[n]);    break;
+					case LIBRARY_GEOMETRIES: mGeometries.fragments[n].object = parse<Geometry> (mGeometries.fragments[n]); break;
+					
+					case LIBRARY_VISUAL_SCENES:
+					{
+						const std::pair<const char*, size_t>& text = splits[n].text[jobs[i].node];
+						
+						ProgressMonitor::check ();
+						
+						Node* node;
+						
+						{
+							MemoryTracker::Hold dom (&mMemory, MEMORY_DOM, MemoryTracker::estimateDOM (text.second));
+							
+							ticpp::Document doc;
+							doc.SetCondenseWhiteSpace (mCondenseWhiteSpace);
+							doc.Parse (std::string (text.first, text.second));
+							
+							node = new Node (doc.FirstChildElement());
+							splits[n].nodes[jobs[i].node] = node;
+						}
+						
+						MemoryCounter counter;
+						counter.add (node, LIBRARY_VISUAL_SCENES);
+						mMemory.allocate (counter.getStats());
+						
+						if (monitor)
+							monitor->advance (text.second, 0);
+						
+						break;
+					}
+					}
+				}
+			});
+			
+			
+			/* stitch the scenes back together */
+			for (size_t i = 0; i < splits.size(); i++)
+			{
+				ticpp::Document doc;
+				doc.SetCondenseWhiteSpace (mCondenseWhiteSpace);
+				doc.Parse (splits[i].shell);
+				
+				/* the scene owns the nodes, even when it fails */
+				NodeList nodes;
+				nodes.swap (splits[i].nodes);
+				
+				mVisualScenes.fragments[i].object = new VisualScene (doc.FirstChildElement(), nodes);
+				
+				if (monitor)
+					monitor->advance (splits[i].shell.size(), 1);
+			}
+		}
+		
+		/* nodes of unfinished scenes are not owned by anything yet */
+		catch (...)
+		{
+			for (size_t i = 0; i < splits.size(); i++)
+			{
+				for (size_t n = 0; n < splits[i].nodes.size(); n++)
+					delete splits[i].nodes[n];
+			}
+			
+			throw;
+		}
+	}
+	
+	
+	
+	
+	/* parse every remaining element of a library */
+	template <typename T>
+	void Document::loadAll (Library<T>& library) const
+	{
+		if (library.complete)
+			return;
+		
+		for (size_t i = 0; i < library.fragments.size(); i++)
+			load (library, i);
+		
+		
+		/* list in document order */
+		library.objects.clear ();
+		
+		for (size_t i = 0; i < library.fragments.size(); i++)
+			library.objects.push_back (library.fragments[i].object);
+		
+		library.fragments.clear ();
+		library.pending.clear ();
+		library.complete = true;
+	}
+	
+	
+	/* free every element of a library */
+	template <typename T>
+	void Document::clear (Library<T>& library)
+	{
+		for (size_t i = 0; i < library.objects.size(); i++)
+			delete library.objects[i];
+		
+		/* elements still waiting to be listed */
+		for (size_t i = 0; i < library.fragments.size(); i++)
+			delete library.fragments[i].object;
+		
+		library = Library<T> ();
+	}
+	
+	
+	/* free everything opened so far */
+	void Document::release ()
+	{
+		clear (mMaterials);
+		clear (mEffects);
+		clear (mGeometries);
+		clear (mVisualScenes);
+		
+		mNodeIndex.clear ();
+		mSIDIndex.clear ();
+		
+		delete mSource;
+		mSource = 0;
+		
+		/* nothing of this document is left in the allocator. an
+		 * allocator shared with other documents may still hold theirs */
+		if (mAllocator.use_count() == 1)
+			mAllocator->release ();
+	}
+	
+	
+	
+	/* find an element by url, parsing it when needed */
+	template <typename T>
+	T* Document::find (Library<T>& library, const std::string& url) const
+	{
+		std::string id = (!url.empty() && url[0] == '#') ? url.substr (1) : url;
+		
+		typename std::unordered_map<std::string, T*>::const_iterator iter = library.index.find (id);
+		
+		if (iter != library.index.end())
+			return iter->second;
+		
+		
+		std::unordered_map<std::string, size_t>::const_iterator pending = library.pending.find (id);
+		return pending == library.pending.end() ? 0 : load (library, pending->second);
 	}
 	
 	
@@ -53,7 +459,10 @@ namespace ColladaParser
 		{
 			/* found effect */
 			if (iter->Value() == "material")
-				mMaterials.push_back (new Material (iter.Get()));
+			{
+				Material* material = new Material (iter.Get());
+				add (mMaterials, material);
+			}
 		}
 	}
 	
@@ -71,7 +480,10 @@ namespace ColladaParser
 		{
 			/* found effect */
 			if (iter->Value() == "effect")
-				mEffects.push_back (new Effect (iter.Get()));
+			{
+				Effect* effect = new Effect (iter.Get());
+				add (mEffects, effect);
+			}
 		}
 	}
 	
@@ -89,7 +501,10 @@ namespace ColladaParser
 		{
 			/* found geometry */
 			if (iter->Value() == "geometry")
-				mGeometries.push_back (new Geometry (iter.Get()));
+			{
+				Geometry* geometry = new Geometry (iter.Get());
+				add (mGeometries, geometry);
+			}
 		}
 		
 	}
@@ -108,18 +523,399 @@ namespace ColladaParser
 		{
 			/* found visual scene */
 			if (iter->Value() == "visual_scene")
-				mVisualScenes.push_back (new VisualScene (iter.Get()));
+			{
+				VisualScene* scene = new VisualScene (iter.Get());
+				add (mVisualScenes, scene);
+			}
+		}
+		
+	}
+	
+	
+	
+	
+	/* index the library elements without parsing them */
+	void Document::scan ()
+	{
+		mSource = new MappedFile (mFile);
+		
+		Scanner scanner (mSource->getData(), mSource->getSize());
+		Scanner::Element root = scanner.getRoot ();
+		
+		std::vector<Scanner::Element> libraries;
+		scanner.getChildren (root, libraries);
+		
+		
+		/* sift through all collada elements */
+		for (size_t i = 0; i < libraries.size(); i++)
+		{
+			const std::string& name = libraries[i].name;
+			
+			std::vector<Scanner::Element> elements;
+			scanner.getChildren (libraries[i], elements);
+			
+			
+			for (size_t e = 0; e < elements.size(); e++)
+			{
+				const Scanner::Element& element = elements[e];
+				
+				if (name == "library_materials" && element.name == "material")
+				{
+					if (mFilter.accepts (LIBRARY_MATERIALS, element.id))
+						add (mMaterials, element.begin, element.end, element.id, std::string());
+				}
+				
+				else if (name == "library_effects" && element.name == "effect")
+				{
+					if (mFilter.accepts (LIBRARY_EFFECTS, element.id))
+						add (mEffects, element.begin, element.end, element.id, std::string());
+				}
+				
+				else if (name == "library_geometries" && element.name == "geometry")
+				{
+					if (mFilter.accepts (LIBRARY_GEOMETRIES, element.id))
+						add (mGeometries, element.begin, element.end, element.id, std::string());
+				}
+				
+				else if (name == "library_visual_scenes" && element.name == "visual_scene")
+				{
+					if (!mFilter.accepts (LIBRARY_VISUAL_SCENES, element.id))
+						continue;
+					
+					/* leave out nodes on other layers */
+					if (mFilter.mLayers.empty())
+						add (mVisualScenes, element.begin, element.end, element.id, std::string());
+					
+					else
+					{
+						std::string text = mFilter.filterScene (scanner, element);
+						
+						if (!text.empty())
+							add (mVisualScenes, element.begin, element.end, element.id, text);
+					}
+				}
+			}
 		}
+	}
+	
+	
+	
+	
+	/* size and modification time of a file */
+	static bool getFileInfo (const std::string& file, uint64_t& size, int64_t& time)
+	{
+		struct stat info;
+		
+		if (stat (file.c_str(), &info) != 0)
+			return false;
+		
+		size = info.st_size;
 		
+#if defined(__APPLE__)
+		time = int64_t (info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+		time = int64_t (info.st_mtime) * 1000000000;
+#else
+		time = int64_t (info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+		
+		return true;
+	}
+	
+	
+	/* content hash of the document file */
+	Hash Document::hashFile () const
+	{
+		if (mSource)
+			return computeHash (mSource->getData(), mSource->getSize());
+		
+		MappedFile file (mFile);
+		return computeHash (file.getData(), file.getSize());
 	}
 	
 	
 	
+	/* read the elements of a library and the ids of collapsed duplicates */
+	template <typename T>
+	void Document::readLibrary (CacheReader& reader, Library<T>& library)
+	{
+		uint32_t count = reader.read<uint32_t> ();
+		
+		for (uint32_t i = 0; i < count; i++)
+			add (library, new T (reader));
+		
+		uint32_t aliases = reader.read<uint32_t> ();
+		
+		for (uint32_t i = 0; i < aliases; i++)
+		{
+			std::string id = reader.readString ();
+			uint32_t index = reader.read<uint32_t> ();
+			
+			if (index >= library.objects.size())
+				throw std::runtime_error ("Invalid cache file: Unknown element");
+			
+			library.index.insert (std::make_pair (id, library.objects[index]));
+		}
+	}
+	
+	
+	/* write the elements of a library and the ids of collapsed duplicates */
+	template <typename T>
+	void Document::writeLibrary (CacheWriter& writer, const Library<T>& library) const
+	{
+		std::unordered_map<const T*, uint32_t> positions;
+		
+		writer.write (uint32_t (library.objects.size()));
+		
+		for (size_t i = 0; i < library.objects.size(); i++)
+		{
+			positions[library.objects[i]] = i;
+			library.objects[i]->write (writer);
+		}
+		
+		
+		std::vector<std::pair<std::string, uint32_t> > aliases;
+		typename std::unordered_map<std::string, T*>::const_iterator iter;
+		
+		for (iter = library.index.begin(); iter != library.index.end(); ++iter)
+		{
+			if (iter->first != iter->second->getID())
+				aliases.push_back (std::make_pair (iter->first, positions[iter->second]));
+		}
+		
+		writer.write (uint32_t (aliases.size()));
+		
+		for (size_t i = 0; i < aliases.size(); i++)
+		{
+			writer.writeString (aliases[i].first);
+			writer.write (aliases[i].second);
+		}
+	}
+	
+	
+	
+	/* options that change what a cache holds */
+	uint32_t Document::getCacheFlags () const
+	{
+		uint32_t flags = mDeduplicate ? CacheHeader::DEDUPLICATED : 0;
+		
+		if (!mCondenseWhiteSpace)
+			flags |= CacheHeader::PRESERVED_WHITE_SPACE;
+		
+		return flags;
+	}
+	
+	
+	/* write every element to a binary cache */
+	void Document::saveCache (const std::string& file) const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		
+		loadAll (mEffects);
+		loadAll (mGeometries);
+		loadAll (mMaterials);
+		loadAll (mVisualScenes);
+		
+		
+		CacheHeader header = CacheHeader ();
+		
+		if (!getFileInfo (mFile, header.sourceSize, header.sourceTime))
+		{
+			std::string error = "Failed to open file '" + mFile + "'";
+			throw std::runtime_error (error.c_str());
+		}
+		
+		header.sourceHash = hashFile ();
+		header.flags = getCacheFlags ();
+		
+		
+		CacheWriter writer (file);
+		
+		writeLibrary (writer, mEffects);
+		writeLibrary (writer, mGeometries);
+		writeLibrary (writer, mMaterials);
+		writeLibrary (writer, mVisualScenes);
+		
+		writer.finish (header);
+	}
+	
+	
+	
+	/* read the document from its cache when it is current */
+	bool Document::loadCache ()
+	{
+		uint64_t size;
+		int64_t time;
+		
+		if (!getFileInfo (mFile, size, time))
+			return false;
+		
+		
+		try
+		{
+			std::shared_ptr<MappedFile> file (new MappedFile (mCache));
+			CacheReader reader (file);
+			
+			const CacheHeader& header = reader.getHeader ();
+			if (header.sourceSize != size || header.flags != getCacheFlags ())
+				return false;
+			
+			/* a touched but unchanged file is still current */
+			if (header.sourceTime != time && header.sourceHash != hashFile ())
+				return false;
+			
+			
+			readLibrary (reader, mEffects);
+			readLibrary (reader, mGeometries);
+			readLibrary (reader, mMaterials);
+			readLibrary (reader, mVisualScenes);
+			
+			if (ProgressMonitor* monitor = ProgressMonitor::getCurrent ())
+			{
+				monitor->setTotal (size, mEffects.objects.size() + mGeometries.objects.size() +
+				                         mMaterials.objects.size() + mVisualScenes.objects.size());
+			}
+		}
+		
+		/* missing or damaged caches are parsed again. a document too
+		 * big for the budget is no smaller parsed */
+		catch (const std::exception& error)
+		{
+			clear (mEffects);
+			clear (mGeometries);
+			clear (mMaterials);
+			clear (mVisualScenes);
+			
+			if (dynamic_cast<const MemoryBudgetExceeded*> (&error))
+				throw;
+			
+			return false;
+		}
+		
+		
+		link ();
+		return true;
+	}
+	
+	
 	
 	/* open document stream */
 	bool Document::open ()
 	{
+		mCancelled.store (false);
+		return openFile (false);
+	}
+	
+	
+	/* open document on another thread. the request is cleared before
+	 * the thread starts so a cancel made right after still counts */
+	std::future<bool> Document::openAsync ()
+	{
+		mCancelled.store (false);
+		return std::async (std::launch::async, &Document::openFile, this, true);
+	}
+	
+	
+	
+	/* open with progress and cancellation */
+	bool Document::openFile (bool incremental)
+	{
+		ProgressMonitor monitor (mCancelled, mProgress);
+		ProgressMonitor::Scope scope (&monitor);
+		StringPool::Scope strings (mStrings);
+		Allocator::Scope allocator (mAllocator.get());
+		MemoryTracker::Scope memory (&mMemory);
+		
+		/* start over on the allocator too */
+		release ();
+		mMemory.reset ();
+		
+		
+		/* filtered documents only hold part of the file */
+		bool cached = !mCache.empty() && mFilter.isEmpty();
+		
+		if (cached && loadCache ())
+		{
+			monitor.finish ();
+			return true;
+		}
+		
+		
+		try
+		{
+			parseFile (incremental || mProgress);
+		}
+		
+		/* drop whatever was parsed */
+		catch (const OpenCancelled&)
+		{
+			release ();
+			throw;
+		}
+		
+		catch (const MemoryBudgetExceeded&)
+		{
+			release ();
+			throw;
+		}
+		
+		monitor.finish ();
+		
+		
+		/* the cache only saves time, failing to write it is no error */
+		if (cached)
+		{
+			try { saveCache (mCache); }
+			catch (const std::exception&) {}
+		}
+		
+		return true;
+	}
+	
+	
+	
+	/* parse the document file */
+	void Document::parseFile (bool incremental)
+	{
+		/* filtered, lazy and parallel documents are parsed element by
+		 * element, as are those reporting progress */
+		if (incremental || mLazy || !mFilter.isEmpty() || mThreads != 1)
+		{
+			scan ();
+			
+			ProgressMonitor::getCurrent()->setTotal (mSource->getSize(), mMaterials.fragments.size() +
+				mEffects.fragments.size() + mGeometries.fragments.size() + mVisualScenes.fragments.size());
+			
+			if (mLazy && !mDeduplicate)
+				return;
+			
+			if (mThreads != 1)
+				parseParallel ();
+			
+			
+			/* referenced libraries first so duplicates are collapsed
+			 * before anything links to them */
+			loadAll (mEffects);
+			loadAll (mGeometries);
+			
+			if (mDeduplicate)
+				deduplicate ();
+			
+			loadAll (mMaterials);
+			loadAll (mVisualScenes);
+			
+			return;
+		}
+		
+		
+		uint64_t size = 0;
+		int64_t time;
+		getFileInfo (mFile, size, time);
+		
+		MemoryTracker::Hold dom (&mMemory, MEMORY_DOM, MemoryTracker::estimateDOM (size));
+		
 		ticpp::Document doc (mFile);
+		doc.SetCondenseWhiteSpace (mCondenseWhiteSpace);
 		doc.LoadFile ();
 		
 		
@@ -130,6 +926,7 @@ namespace ColladaParser
 		for (iter = iter.begin(doc.FirstChildElement()); iter != iter.end(); iter++)
 		{
 			std::string name = iter->Value();
+			ProgressMonitor::check ();
 			
 			/* found material library */
 			if (name == "library_materials")
@@ -150,7 +947,490 @@ namespace ColladaParser
 		}
 		
 		
-		return true;
+		if (mDeduplicate)
+			deduplicate ();
+		
+		/* resolve references now that every library is known */
+		link ();
+	}
+	
+	
+	
+	
+	/* collapse identical content.
+	 * content is looked up by its 128 bit hash and compared in full on
+	 * a match, so crafted collisions are kept apart rather than merged */
+	void Document::deduplicate ()
+	{
+		/* geometries */
+		std::unordered_map<Hash, Geometry*, Hash::Key> geometries;
+		GeometryList keptGeometries;
+		
+		for (size_t i = 0; i < mGeometries.objects.size(); i++)
+		{
+			Geometry* geometry = mGeometries.objects[i];
+			std::pair<std::unordered_map<Hash, Geometry*, Hash::Key>::iterator, bool> result;
+			result = geometries.insert (std::make_pair (geometry->getHash(), geometry));
+			
+			Geometry* kept = result.first->second;
+			
+			if (result.second || !geometry->isEqual (*kept))
+			{
+				keptGeometries.push_back (geometry);
+				continue;
+			}
+			
+			
+			/* alias the duplicate id to the kept geometry */
+			std::unordered_map<std::string, Geometry*>::iterator alias = mGeometries.index.find (geometry->getID());
+			
+			if (alias != mGeometries.index.end() && alias->second == geometry)
+				alias->second = kept;
+			
+			mDeduplicationStats.geometries++;
+			mDeduplicationStats.bytesSaved += geometry->getDataSize();
+			delete geometry;
+		}
+		
+		mGeometries.objects.swap (keptGeometries);
+		
+		
+		/* source arrays shared between the remaining geometries */
+		std::unordered_map<Hash, Source*, Hash::Key> sources;
+		
+		for (size_t i = 0; i < mGeometries.objects.size(); i++)
+		{
+			const SourceMap& map = mGeometries.objects[i]->getSources ();
+			SourceMap::const_iterator iter;
+			
+			for (iter = map.begin(); iter != map.end(); iter++)
+			{
+				Source* source = dynamic_cast<Source*> (iter->second);
+				if (!source) continue;
+				
+				std::pair<std::unordered_map<Hash, Source*, Hash::Key>::iterator, bool> result;
+				result = sources.insert (std::make_pair (source->getHash(), source));
+				
+				Source* kept = result.first->second;
+				
+				if (result.second || source->isSharing (*kept) || !source->isEqual (kept))
+					continue;
+				
+				mDeduplicationStats.sources++;
+				mDeduplicationStats.bytesSaved += source->getDataSize();
+				source->share (*kept);
+			}
+		}
+		
+		
+		/* effects */
+		std::unordered_map<Hash, Effect*, Hash::Key> effects;
+		EffectList keptEffects;
+		
+		for (size_t i = 0; i < mEffects.objects.size(); i++)
+		{
+			Effect* effect = mEffects.objects[i];
+			std::pair<std::unordered_map<Hash, Effect*, Hash::Key>::iterator, bool> result;
+			result = effects.insert (std::make_pair (effect->getHash(), effect));
+			
+			Effect* kept = result.first->second;
+			
+			if (result.second || !effect->isEqual (*kept))
+			{
+				keptEffects.push_back (effect);
+				continue;
+			}
+			
+			
+			/* alias the duplicate id to the kept effect */
+			std::unordered_map<std::string, Effect*>::iterator alias = mEffects.index.find (effect->getID());
+			
+			if (alias != mEffects.index.end() && alias->second == effect)
+				alias->second = kept;
+			
+			mDeduplicationStats.effects++;
+			mDeduplicationStats.bytesSaved += sizeof (Effect) + effect->getCommonProfiles().size() * sizeof (ProfileCommon);
+			delete effect;
+		}
+		
+		mEffects.objects.swap (keptEffects);
+	}
+	
+	
+	
+	
+	/* index node identifiers */
+	void Document::indexNode (const void* owner, Node* node) const
+	{
+		if (!node->getID().empty())
+			mNodeIndex.insert (std::make_pair (node->getID(), node));
+		
+		if (!node->getSID().empty())
+		{
+			SIDTarget target;
+			target.node = node;
+			mSIDIndex.insert (std::make_pair (SIDKey (owner, node->getSID()), target));
+		}
+		
+		
+		/* transforms */
+		const TransformList& transforms = node->getTransforms ();
+		
+		for (size_t i = 0; i < transforms.size(); i++)
+		{
+			if (transforms[i]->getSID().empty())
+				continue;
+			
+			SIDTarget target;
+			target.transform = transforms[i];
+			mSIDIndex.insert (std::make_pair (SIDKey (node, transforms[i]->getSID()), target));
+		}
+		
+		
+		/* geometry instances */
+		const GeometryInstanceList& instances = node->getGeometries ();
+		
+		for (size_t i = 0; i < instances.size(); i++)
+		{
+			GeometryInstance* instance = instances[i];
+			instance->document = this;
+			
+			/* lazy documents only parse what is instanced when it is used */
+			if (!mLazy)
+				resolve (instance);
+			
+			if (!instance->sid.empty())
+			{
+				SIDTarget target;
+				target.geometry = instance;
+				mSIDIndex.insert (std::make_pair (SIDKey (node, instance->sid), target));
+			}
+		}
+		
+		
+		/* children are scoped by this node */
+		const NodeList& children = node->getChildren ();
+		
+		for (size_t i = 0; i < children.size(); i++)
+			indexNode (node, children[i]);
+	}
+	
+	
+	
+	
+	/* resolve the geometry and bound materials of an instance */
+	void Document::resolve (const GeometryInstance* instance) const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		
+		if (instance->resolved.load (std::memory_order_relaxed))
+			return;
+		
+		GeometryInstance* target = const_cast<GeometryInstance*> (instance);
+		target->geometry = getGeometry (instance->url);
+		
+		/* bound materials */
+		if (target->materials)
+		{
+			StringMap::iterator iter;
+			StringMap& materials = target->materials->materials;
+			
+			for (iter = materials.begin(); iter != materials.end(); ++iter)
+				target->materials->targets[iter->first] = getMaterial (iter->second);
+		}
+		
+		instance->resolved.store (true, std::memory_order_release);
+	}
+	
+	
+	
+	/* link a material to its effect */
+	void Document::attach (Material* material) const
+	{
+		material->mEffect.effect = getEffect (material->getEffect().url);
+	}
+	
+	
+	/* index the nodes of a scene and link their instances */
+	void Document::attach (VisualScene* scene) const
+	{
+		const NodeList& nodes = scene->getNodes ();
+		
+		for (size_t n = 0; n < nodes.size(); n++)
+			indexNode (scene, nodes[n]);
+	}
+	
+	
+	
+	/* resolve url references */
+	void Document::link ()
+	{
+		for (size_t i = 0; i < mMaterials.objects.size(); i++)
+			attach (mMaterials.objects[i]);
+		
+		for (size_t i = 0; i < mVisualScenes.objects.size(); i++)
+			attach (mVisualScenes.objects[i]);
+	}
+	
+	
+	
+	
+	/* count the elements of a library, or the text of those not parsed */
+	template <typename L>
+	static void countLibrary (MemoryCounter& counter, const L& library)
+	{
+		for (size_t i = 0; i < library.objects.size(); i++)
+			counter.add (library.objects[i]);
+		
+		for (size_t i = 0; i < library.fragments.size(); i++)
+		{
+			if (library.fragments[i].object)
+				counter.add (library.fragments[i].object);
+			
+			/* unfiltered text stays in the mapped file */
+			else if (!library.fragments[i].text.empty())
+				counter.addText (library.fragments[i].text.capacity());
+		}
+	}
+	
+	
+	/* allocator of the elements */
+	void Document::setAllocator (const std::shared_ptr<Allocator>& allocator)
+	{
+		release ();
+		mAllocator = allocator;
+	}
+	
+	
+	/* large arrays kept off the heap */
+	void Document::setOutOfCore (size_t bytes, const std::string& directory)
+	{
+		mMemory.setOutOfCore (bytes, directory);
+	}
+	
+	
+	/* memory held */
+	MemoryStats Document::getMemoryStats () const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		
+		MemoryCounter counter;
+		
+		countLibrary (counter, mMaterials);
+		countLibrary (counter, mEffects);
+		countLibrary (counter, mGeometries);
+		countLibrary (counter, mVisualScenes);
+		
+		counter.addStrings (mStrings->getStats());
+		
+		if (mSource)
+			counter.addMapping (mSource);
+		
+		
+		MemoryStats stats = counter.getStats ();
+		mMemory.getPeaks (stats);
+		
+		/* never report a peak below what is held now */
+		for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+			stats.peaks[i] = std::max (stats.peaks[i], stats.categories[i].bytes);
+		
+		stats.peak = std::max (stats.peak, stats.getBytes());
+		return stats;
+	}
+	
+	
+	
+	
+	/* libraries, parsed on first access in lazy mode */
+	const MaterialList& Document::getMaterials () const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		loadAll (mMaterials);
+		return mMaterials.objects;
+	}
+	
+	
+	const EffectList& Document::getEffects () const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		loadAll (mEffects);
+		return mEffects.objects;
+	}
+	
+	
+	const GeometryList& Document::getGeometries () const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		loadAll (mGeometries);
+		return mGeometries.objects;
+	}
+	
+	
+	const VisualSceneList& Document::getVisualScenes () const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		loadAll (mVisualScenes);
+		return mVisualScenes.objects;
+	}
+	
+	
+	
+	
+	Material* Document::getMaterial (const std::string& url) const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		return find (mMaterials, url);
+	}
+	
+	
+	Effect* Document::getEffect (const std::string& url) const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		return find (mEffects, url);
+	}
+	
+	
+	Geometry* Document::getGeometry (const std::string& url) const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		return find (mGeometries, url);
+	}
+	
+	
+	VisualScene* Document::getVisualScene (const std::string& url) const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		return find (mVisualScenes, url);
+	}
+	
+	
+	Node* Document::getNode (const std::string& url) const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		
+		/* nodes are only known once their scenes are parsed */
+		loadAll (mVisualScenes);
+		
+		std::string id = (!url.empty() && url[0] == '#') ? url.substr (1) : url;
+		
+		std::unordered_map<std::string, Node*>::const_iterator iter = mNodeIndex.find (id);
+		return iter == mNodeIndex.end() ? 0 : iter->second;
+	}
+	
+	
+	
+	
+	/* breadth first search for the nearest scoped identifier */
+	SIDTarget Document::findSID (const void* scope, const NodeList& nodes, const std::string& sid) const
+	{
+		std::unordered_map<SIDKey, SIDTarget, SIDHash>::const_iterator found;
+		
+		found = mSIDIndex.find (SIDKey (scope, sid));
+		if (found != mSIDIndex.end())
+			return found->second;
+		
+		
+		std::deque<const Node*> queue (nodes.begin(), nodes.end());
+		
+		while (!queue.empty())
+		{
+			const Node* node = queue.front ();
+			queue.pop_front ();
+			
+			found = mSIDIndex.find (SIDKey (node, sid));
+			if (found != mSIDIndex.end())
+				return found->second;
+			
+			const NodeList& children = node->getChildren ();
+			queue.insert (queue.end(), children.begin(), children.end());
+		}
+		
+		return SIDTarget ();
+	}
+	
+	
+	
+	
+	/* walk a scoped identifier path */
+	SIDTarget Document::resolvePath (const void* scope, const NodeList* nodes, const std::string& path) const
+	{
+		SIDTarget target;
+		size_t begin = 0;
+		
+		
+		while (begin <= path.size())
+		{
+			size_t end = path.find ('/', begin);
+			if (end == std::string::npos) end = path.size ();
+			
+			std::string sid = path.substr (begin, end - begin);
+			
+			/* drop any member selection from the final part */
+			if (end == path.size())
+				sid = sid.substr (0, sid.find_first_of (".("));
+			
+			
+			/* only nodes can scope further identifiers */
+			if (!scope)
+				return SIDTarget ();
+			
+			target = findSID (scope, *nodes, sid);
+			
+			if (target.node)
+			{
+				scope = target.node;
+				nodes = &target.node->getChildren ();
+			}
+			else scope = 0;
+			
+			
+			if (!target.node && !target.transform && !target.geometry)
+				return target;
+			
+			begin = end + 1;
+		}
+		
+		return target;
+	}
+	
+	
+	
+	
+	/* resolve an address starting with an element id */
+	SIDTarget Document::resolveSID (const std::string& address) const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		
+		size_t end = address.find ('/');
+		std::string id = address.substr (0, end);
+		
+		
+		/* the address may start from a node or a visual scene */
+		Node* node = getNode (id);
+		VisualScene* scene = node ? 0 : getVisualScene (id);
+		
+		SIDTarget target;
+		target.node = node;
+		
+		if (end == std::string::npos)
+			return target;
+		
+		
+		if (node)
+			return resolvePath (node, &node->getChildren(), address.substr (end + 1));
+		
+		else if (scene)
+			return resolvePath (scene, &scene->getNodes(), address.substr (end + 1));
+		
+		return SIDTarget ();
+	}
+	
+	
+	/* resolve a path relative to a node */
+	SIDTarget Document::resolveSID (const Node* scope, const std::string& path) const
+	{
+		std::lock_guard<std::recursive_mutex> lock (mLoadMutex);
+		return resolvePath (scope, &scope->getChildren(), path);
 	}
 
 }
@@ -0,0 +1,169 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "DrawList.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "TransformEvaluator.h"
+
+
+namespace ColladaParser
+{
+
+	/* a single draw before merging. the ranks follow document order
+	 * so that the result doesn't depend on allocation addresses */
+	struct DrawKey
+	{
+		size_t effect;
+		size_t material;
+		size_t geometry;
+		size_t primitive;
+		size_t transform;
+		
+		DrawList::Draw draw;
+		
+		bool operator< (const DrawKey& key) const
+		{
+			if (effect    != key.effect)    return effect    < key.effect;
+			if (material  != key.material)  return material  < key.material;
+			if (geometry  != key.geometry)  return geometry  < key.geometry;
+			if (primitive != key.primitive) return primitive < key.primitive;
+			return transform < key.transform;
+		}
+		
+		bool sameRun (const DrawKey& key) const
+		{
+			return effect == key.effect && material == key.material &&
+					geometry == key.geometry && primitive == key.primitive;
+		}
+	};
+	
+	
+	
+	/* rank list elements by their position */
+	template <typename T>
+	static void rank (const std::vector<T*>& list, std::unordered_map<const T*, size_t>& ranks)
+	{
+		/* unknown elements sort first */
+		ranks[0] = 0;
+		
+		for (size_t i = 0; i < list.size(); i++)
+			ranks[list[i]] = i + 1;
+	}
+	
+	
+	
+	
+	/* constructor */
+	DrawList::DrawList (const Document* document, const TransformEvaluator* transforms)
+	{
+		build (document, transforms);
+	}
+	
+	
+	
+	
+	/* gather, sort and merge the scene draws */
+	void DrawList::build (const Document* document, const TransformEvaluator* transforms)
+	{
+		std::unordered_map<const Effect*, size_t>   effects;
+		std::unordered_map<const Material*, size_t> materials;
+		std::unordered_map<const Geometry*, size_t> geometries;
+		
+		rank (document->getEffects(),    effects);
+		rank (document->getMaterials(),  materials);
+		rank (document->getGeometries(), geometries);
+		
+		
+		std::vector<DrawKey> keys;
+		
+		for (size_t n = 0; n < transforms->getNodeCount(); n++)
+		{
+			const GeometryInstanceList& instances = transforms->getNode(n)->getGeometries ();
+			
+			for (size_t i = 0; i < instances.size(); i++)
+			{
+				const GeometryInstance* instance = instances[i];
+				const Geometry* geometry = instance->getGeometry ();
+				
+				if (!geometry)
+					continue;
+				
+				
+				const std::vector<Primitive*>& primitives = geometry->getPrimitives ();
+				
+				for (size_t p = 0; p < primitives.size(); p++)
+				{
+					DrawKey key;
+					key.draw.geometry  = geometry;
+					key.draw.primitive = primitives[p];
+					key.draw.material  = 0;
+					key.draw.effect    = 0;
+					
+					
+					/* look up the bound material by the primitive symbol */
+					const Material* material = instance->getMaterial (primitives[p]->getMaterial());
+					
+					if (material)
+					{
+						key.draw.material = material;
+						key.draw.effect = material->getEffect().effect;
+					}
+					
+					key.effect    = effects[key.draw.effect];
+					key.material  = materials[key.draw.material];
+					key.geometry  = geometries[geometry];
+					key.primitive = p;
+					key.transform = n;
+					
+					keys.push_back (key);
+				}
+			}
+		}
+		
+		
+		std::sort (keys.begin(), keys.end());
+		
+		
+		/* merge runs of the same primitive */
+		mTransforms.reserve (keys.size());
+		
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			if (i == 0 || !keys[i].sameRun (keys[i - 1]))
+			{
+				Draw draw = keys[i].draw;
+				draw.first = mTransforms.size ();
+				draw.count = 0;
+				
+				mDraws.push_back (draw);
+			}
+			
+			mDraws.back().count++;
+			mTransforms.push_back (keys[i].transform);
+		}
+	}
+
+}
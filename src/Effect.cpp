@@ -25,26 +25,88 @@ THE SOFTWARE.
 #include <stdexcept>
 #include <ticpp/ticpp.h>
 
+#include "Cache.h"
+
 
 namespace ColladaParser
 {
 
 	/* constructor */
 	Effect::Effect (ticpp::Element* element)
+	: mStrings (StringPool::acquire ())
 	{
-		parse (element);
+		try
+		{
+			parse (element);
+		}
+		catch (...)
+		{
+			release ();
+			throw;
+		}
+	}
+	
+	
+	/* constructor */
+	Effect::Effect (CacheReader& reader)
+	: mStrings (StringPool::acquire ())
+	{
+		try
+		{
+			mID   = mStrings->intern (reader.readString (), STRING_ID);
+			mName = mStrings->intern (reader.readString (), STRING_NAME);
+			
+			uint32_t profiles = reader.read<uint32_t> ();
+			
+			for (uint32_t i = 0; i < profiles; i++)
+				mCommonProfiles.push_back (new ProfileCommon (reader));
+			
+			mParams = reader.readString ();
+			mHash = reader.read<Hash> ();
+		}
+		catch (...)
+		{
+			release ();
+			throw;
+		}
 	}
 	
 	
 	/* destructor */
 	Effect::~Effect ()
 	{
-		
+		release ();
+	}
+	
+	
+	/* free everything the effect owns */
+	void Effect::release ()
+	{
+		/* free profiles */
+		for (int i = 0; i < mCommonProfiles.size(); i++)
+			delete mCommonProfiles[i];
 	}
 	
 	
 	
 	
+	/* write effect */
+	void Effect::write (CacheWriter& writer) const
+	{
+		writer.writeString (mID);
+		writer.writeString (mName);
+		
+		writer.write (uint32_t (mCommonProfiles.size()));
+		
+		for (int i = 0; i < mCommonProfiles.size(); i++)
+			mCommonProfiles[i]->write (writer);
+		
+		writer.writeString (mParams);
+		writer.write (mHash);
+	}
+	
+	
+	
 	/* parse effect element */
 	void Effect::parse (ticpp::Element* element)
 	{
@@ -52,8 +114,8 @@ namespace ColladaParser
 		
 		
 		/* effect properties */
-		mID   = element->GetAttribute ("id");
-		mName = element->GetAttributeOrDefault ("name", "");
+		mID   = mStrings->intern (element->GetAttribute ("id"), STRING_ID);
+		mName = mStrings->intern (element->GetAttributeOrDefault ("name", ""), STRING_NAME);
 		
 		
 		/* sift through effect elements
@@ -67,7 +129,44 @@ namespace ColladaParser
 			/* found a profile */
 			if (val == "profile_COMMON")
 				mCommonProfiles.push_back (new ProfileCommon (child));
+			
+			/* found a parameter */
+			else if (val == "newparam")
+			{
+				TiXmlPrinter printer;
+				printer.SetStreamPrinting ();
+				
+				child->Accept (&printer);
+				mParams += printer.CStr ();
+			}
+		}
+		
+		
+		/* hash profiles */
+		Hasher hasher;
+		
+		for (int i = 0; i < mCommonProfiles.size(); i++)
+			hasher.add (mCommonProfiles[i]->getHash());
+		
+		hasher.add (mParams);
+		mHash = hasher.getHash();
+	}
+	
+	
+	
+	/* compare everything hashed */
+	bool Effect::isEqual (const Effect& effect) const
+	{
+		if (mParams != effect.mParams || mCommonProfiles.size() != effect.mCommonProfiles.size())
+			return false;
+		
+		for (size_t i = 0; i < mCommonProfiles.size(); i++)
+		{
+			if (!mCommonProfiles[i]->isEqual (*effect.mCommonProfiles[i]))
+				return false;
 		}
+		
+		return true;
 	}
 
 }
@@ -22,9 +22,15 @@ THE SOFTWARE.
 
 #include "Geometry.h"
 
+#include <limits>
+#include <algorithm>
 #include <stdexcept>
 #include <ticpp/ticpp.h>
 
+#include "Cache.h"
+#include "Progress.h"
+#include "Memory.h"
+
 
 namespace ColladaParser
 {
@@ -34,13 +40,61 @@ namespace ColladaParser
 	: mIndices (new Indices ()),
 	  mSources (sources)
 	{
-		parse (element);
+		try
+		{
+			parse (element);
+		}
+		catch (...)
+		{
+			release ();
+			throw;
+		}
+	}
+	
+	
+	
+	/* constructor */
+	Primitive::Primitive (CacheReader& reader, SourceMap* sources)
+	: mIndices (new Indices ()),
+	  mSources (sources)
+	{
+		try
+		{
+			StringPool* strings = StringPool::getCurrent ();
+			
+			mName     = strings->intern (reader.readString (), STRING_NAME);
+			mMaterial = strings->intern (reader.readString (), STRING_SYMBOL);
+			
+			uint32_t inputs = reader.read<uint32_t> ();
+			
+			for (uint32_t i = 0; i < inputs; i++)
+			{
+				Input* input = new Input (reader, *mSources);
+				input->setIndices (mIndices);
+				mInputs.push_back (input);
+			}
+			
+			mIndices->read (reader);
+			mHash = reader.read<Hash> ();
+		}
+		catch (...)
+		{
+			release ();
+			throw;
+		}
 	}
 	
 	
 	
 	/* destructor */
 	Primitive::~Primitive ()
+	{
+		release ();
+	}
+	
+	
+	/* free inputs and indices */
+	void Primitive::release ()
 	{
 		/* free inputs */
 		for (int i = 0; i < mInputs.size(); i++)
@@ -162,12 +216,32 @@ namespace ColladaParser
 	
 	
 	
+	/* write primitive */
+	void Primitive::write (CacheWriter& writer) const
+	{
+		writer.writeString (mName);
+		writer.writeString (mMaterial);
+		
+		writer.write (uint32_t (mInputs.size()));
+		
+		for (int i = 0; i < mInputs.size(); i++)
+			mInputs[i]->write (writer);
+		
+		mIndices->write (writer);
+		writer.write (mHash);
+	}
+	
+	
+	
+	
 	/* parse triangle primitive */
 	void Primitive::parse (ticpp::Element *element)
 	{
 		/* get properties */
-		mName     = element->GetAttributeOrDefault ("name", "");
-		mMaterial = element->GetAttributeOrDefault ("material", "");
+		StringPool* strings = StringPool::getCurrent ();
+		
+		mName     = strings->intern (element->GetAttributeOrDefault ("name", ""), STRING_NAME);
+		mMaterial = strings->intern (element->GetAttributeOrDefault ("material", ""), STRING_SYMBOL);
 		
 		
 		/* index stride */
@@ -177,7 +251,8 @@ namespace ColladaParser
 		int count;
 		element->GetAttribute ("count", &count);
 		
-		mIndices->reserve (count);
+		/* at least a triangle per count before trusting it */
+		MemoryTracker::check (MEMORY_INDICES, size_t (count) * 3 * sizeof (int));
 		
 		
 		ticpp::Iterator<ticpp::Element> iter;
@@ -219,10 +294,20 @@ namespace ColladaParser
 				/* total indicies. triangles have a unit size of three */
 				unsigned int total = (count * stride) * 3;
 				
+				/* never more indices than the text can hold */
+				if (total > data.size() / 2 + 1)
+					total = data.size() / 2 + 1;
+				
+				MemoryTracker::check (MEMORY_INDICES, size_t (total) * sizeof (int));
+				mIndices->reserve (total);
+				
 				
 				/* convert and add to array */
 				for (int i = 0; i < total; i++)
 				{
+					if ((i & 4095) == 0)
+						ProgressMonitor::check ();
+					
 					unsigned int index;
 					stream >> index;
 					
@@ -235,6 +320,36 @@ namespace ColladaParser
 		
 		/* set indices stride */
 		mIndices->setStride (stride);
+		
+		
+		/* hash the primitive contents */
+		Hasher hasher;
+		hasher.add (mMaterial);
+		hasher.add (mIndices->getHash());
+		
+		for (int i = 0; i < mInputs.size(); i++)
+			hasher.add (mInputs[i]->getHash());
+		
+		mHash = hasher.getHash();
+	}
+	
+	
+	/* compare everything hashed */
+	bool Primitive::isEqual (const Primitive& primitive) const
+	{
+		if (mMaterial != primitive.mMaterial || mInputs.size() != primitive.mInputs.size())
+			return false;
+		
+		if (!mIndices->isEqual (*primitive.mIndices))
+			return false;
+		
+		for (size_t i = 0; i < mInputs.size(); i++)
+		{
+			if (!mInputs[i]->isEqual (primitive.mInputs[i]))
+				return false;
+		}
+		
+		return true;
 	}
 	
 	
@@ -244,20 +359,201 @@ namespace ColladaParser
 
 	/* constructor */
 	Geometry::Geometry (ticpp::Element *element)
+	: mStrings (StringPool::acquire ()),
+	  mPositions (0)
 	{
-		parse (element);
+		StringPool::Scope scope (mStrings);
+		
+		try
+		{
+			parse (element);
+		}
+		catch (...)
+		{
+			release ();
+			throw;
+		}
+	}
+	
+	
+	
+	/* constructor */
+	Geometry::Geometry (CacheReader& reader)
+	: mStrings (StringPool::acquire ()),
+	  mPositions (0)
+	{
+		StringPool::Scope scope (mStrings);
+		
+		try
+		{
+			mID   = mStrings->intern (reader.readString (), STRING_ID);
+			mName = mStrings->intern (reader.readString (), STRING_NAME);
+			
+			/* sources before the inputs which refer to them */
+			uint32_t sources = reader.read<uint32_t> ();
+			
+			for (uint32_t i = 0; i < sources; i++)
+			{
+				std::string id = reader.readString ();
+				mSources[id] = new Source (reader);
+			}
+			
+			uint32_t inputs = reader.read<uint32_t> ();
+			
+			for (uint32_t i = 0; i < inputs; i++)
+			{
+				std::string id = reader.readString ();
+				mSources[id] = new Input (reader, mSources);
+			}
+			
+			std::string positions = reader.readString ();
+			
+			if (!positions.empty())
+				mPositions = mSources[positions];
+			
+			
+			uint32_t primitives = reader.read<uint32_t> ();
+			
+			for (uint32_t i = 0; i < primitives; i++)
+				mPrimitives.push_back (new Primitive (reader, &mSources));
+			
+			mHash = reader.read<Hash> ();
+		}
+		catch (...)
+		{
+			release ();
+			throw;
+		}
 	}
 	
 	
 	
 	/* destructor */
 	Geometry::~Geometry ()
+	{
+		release ();
+	}
+	
+	
+	/* free sources and primitives */
+	void Geometry::release ()
 	{
 		SourceMap::iterator iter;
 		
 		/* free sources and VERTEX input */
 		for (iter = mSources.begin(); iter != mSources.end(); iter++)
 			delete iter->second;
+		
+		/* free primitives */
+		for (int i = 0; i < mPrimitives.size(); i++)
+			delete mPrimitives[i];
+	}
+	
+	
+	
+	/* total data size */
+	size_t Geometry::getDataSize () const
+	{
+		size_t size = 0;
+		SourceMap::const_iterator iter;
+		
+		for (iter = mSources.begin(); iter != mSources.end(); iter++)
+		{
+			Source* source = dynamic_cast<Source*> (iter->second);
+			if (source) size += source->getDataSize();
+		}
+		
+		for (int i = 0; i < mPrimitives.size(); i++)
+			size += mPrimitives[i]->getDataSize();
+		
+		return size;
+	}
+	
+	
+	
+	/* compute position bounds */
+	Bounds Geometry::computeBounds () const
+	{
+		Bounds bounds;
+		bounds.min.x = bounds.min.y = bounds.min.z =  std::numeric_limits<float>::max ();
+		bounds.max.x = bounds.max.y = bounds.max.z = -std::numeric_limits<float>::max ();
+		
+		if (!mPositions)
+			return bounds;
+		
+		
+		const DataSource::Accessor& accessor = mPositions->getAccessor ();
+		
+		for (unsigned int i = 0; i < accessor.count; i++)
+		{
+			int index = i * accessor.stride + accessor.offset;
+			
+			float x = mPositions->getData (index);
+			float y = mPositions->getData (index + 1);
+			float z = mPositions->getData (index + 2);
+			
+			bounds.min.x = std::min (bounds.min.x, x);
+			bounds.min.y = std::min (bounds.min.y, y);
+			bounds.min.z = std::min (bounds.min.z, z);
+			
+			bounds.max.x = std::max (bounds.max.x, x);
+			bounds.max.y = std::max (bounds.max.y, y);
+			bounds.max.z = std::max (bounds.max.z, z);
+		}
+		
+		return bounds;
+	}
+	
+	
+	
+	/* write geometry */
+	void Geometry::write (CacheWriter& writer) const
+	{
+		SourceMap::const_iterator iter;
+		std::vector<std::pair<std::string, Source*> > sources;
+		std::vector<std::pair<std::string, Input*> > inputs;
+		std::string positions;
+		
+		for (iter = mSources.begin(); iter != mSources.end(); iter++)
+		{
+			Source* source = dynamic_cast<Source*> (iter->second);
+			
+			if (source) sources.push_back (std::make_pair (iter->first, source));
+			else inputs.push_back (std::make_pair (iter->first, static_cast<Input*> (iter->second)));
+			
+			if (iter->second == mPositions)
+				positions = iter->first;
+		}
+		
+		
+		writer.writeString (mID);
+		writer.writeString (mName);
+		
+		writer.write (uint32_t (sources.size()));
+		
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			writer.writeString (sources[i].first);
+			sources[i].second->write (writer);
+		}
+		
+		writer.write (uint32_t (inputs.size()));
+		
+		for (size_t i = 0; i < inputs.size(); i++)
+		{
+			writer.writeString (inputs[i].first);
+			inputs[i].second->write (writer);
+		}
+		
+		writer.writeString (positions);
+		
+		
+		writer.write (uint32_t (mPrimitives.size()));
+		
+		for (int i = 0; i < mPrimitives.size(); i++)
+			mPrimitives[i]->write (writer);
+		
+		writer.write (mHash);
 	}
 	
 	
@@ -273,8 +569,8 @@ namespace ColladaParser
 		
 		
 		/* geometry properties */
-		mID   = element->GetAttribute ("id");
-		mName = element->GetAttributeOrDefault ("name", "");
+		mID   = mStrings->intern (element->GetAttribute ("id"), STRING_ID);
+		mName = mStrings->intern (element->GetAttributeOrDefault ("name", ""), STRING_NAME);
 		
 		
 		
@@ -291,7 +587,7 @@ namespace ColladaParser
 		/* no mesh found */
 		if (!mesh)
 		{
-			std::string error = "Parsing failed: No mesh specified in geometry '" + mID + " (" + mName + ")'";
+			std::string error = "Parsing failed: No mesh specified in geometry '" + mID.str() + " (" + mName.str() + ")'";
 			throw std::runtime_error (error.c_str());
 		}
 		
@@ -324,7 +620,11 @@ namespace ColladaParser
 				
 				/* create input and add to sources since the vertex
 				 * input can be daisy chained as it often is with VERTEX */
-				mSources[id] = new Input (iter->FirstChildElement(), mSources);
+				Input* input = new Input (iter->FirstChildElement(), mSources);
+				mSources[id] = input;
+				
+				if (input->getSemantic() == INPUT_SEMANTIC_POSITION)
+					mPositions = input;
 			}
 			
 			
@@ -333,6 +633,31 @@ namespace ColladaParser
 				mPrimitives.push_back (new Primitive (iter.Get(), &mSources));
 			
 		} /* end mesh */
+		
+		
+		/* hash the mesh contents */
+		Hasher hasher;
+		
+		for (int i = 0; i < mPrimitives.size(); i++)
+			hasher.add (mPrimitives[i]->getHash());
+		
+		mHash = hasher.getHash();
+	}
+	
+	
+	/* compare everything hashed */
+	bool Geometry::isEqual (const Geometry& geometry) const
+	{
+		if (mPrimitives.size() != geometry.mPrimitives.size())
+			return false;
+		
+		for (size_t i = 0; i < mPrimitives.size(); i++)
+		{
+			if (!mPrimitives[i]->isEqual (*geometry.mPrimitives[i]))
+				return false;
+		}
+		
+		return true;
 	}
 
 }
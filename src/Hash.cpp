@@ -0,0 +1,127 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "Hash.h"
+
+#include <cstring>
+
+
+namespace ColladaParser
+{
+
+	static inline uint64_t rotate (uint64_t x, int r)
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+	
+	
+	static inline uint64_t mix (uint64_t k)
+	{
+		k ^= k >> 33;
+		k *= 0xff51afd7ed558ccdULL;
+		k ^= k >> 33;
+		k *= 0xc4ceb9fe1a85ec53ULL;
+		k ^= k >> 33;
+		return k;
+	}
+	
+	
+	
+	
+	/* MurmurHash3 x64 128 */
+	Hash computeHash (const void* data, size_t size, const Hash& seed)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*> (data);
+		size_t blocks = size / 16;
+		
+		uint64_t h1 = seed.low;
+		uint64_t h2 = seed.high;
+		
+		const uint64_t c1 = 0x87c37b91114253d5ULL;
+		const uint64_t c2 = 0x4cf5ad432745937fULL;
+		
+		
+		/* body */
+		for (size_t i = 0; i < blocks; i++)
+		{
+			uint64_t k1, k2;
+			std::memcpy (&k1, bytes + i * 16,     8);
+			std::memcpy (&k2, bytes + i * 16 + 8, 8);
+			
+			k1 *= c1; k1 = rotate (k1, 31); k1 *= c2; h1 ^= k1;
+			h1 = rotate (h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+			
+			k2 *= c2; k2 = rotate (k2, 33); k2 *= c1; h2 ^= k2;
+			h2 = rotate (h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+		}
+		
+		
+		/* tail */
+		const unsigned char* tail = bytes + blocks * 16;
+		uint64_t k1 = 0;
+		uint64_t k2 = 0;
+		
+		switch (size & 15)
+		{
+		case 15: k2 ^= uint64_t (tail[14]) << 48; /* fall through */
+		case 14: k2 ^= uint64_t (tail[13]) << 40; /* fall through */
+		case 13: k2 ^= uint64_t (tail[12]) << 32; /* fall through */
+		case 12: k2 ^= uint64_t (tail[11]) << 24; /* fall through */
+		case 11: k2 ^= uint64_t (tail[10]) << 16; /* fall through */
+		case 10: k2 ^= uint64_t (tail[9])  << 8;  /* fall through */
+		case 9:  k2 ^= uint64_t (tail[8]);
+			k2 *= c2; k2 = rotate (k2, 33); k2 *= c1; h2 ^= k2;
+			/* fall through */
+			
+		case 8:  k1 ^= uint64_t (tail[7]) << 56; /* fall through */
+		case 7:  k1 ^= uint64_t (tail[6]) << 48; /* fall through */
+		case 6:  k1 ^= uint64_t (tail[5]) << 40; /* fall through */
+		case 5:  k1 ^= uint64_t (tail[4]) << 32; /* fall through */
+		case 4:  k1 ^= uint64_t (tail[3]) << 24; /* fall through */
+		case 3:  k1 ^= uint64_t (tail[2]) << 16; /* fall through */
+		case 2:  k1 ^= uint64_t (tail[1]) << 8;  /* fall through */
+		case 1:  k1 ^= uint64_t (tail[0]);
+			k1 *= c1; k1 = rotate (k1, 31); k1 *= c2; h1 ^= k1;
+		}
+		
+		
+		/* finalisation */
+		h1 ^= size;
+		h2 ^= size;
+		
+		h1 += h2;
+		h2 += h1;
+		
+		h1 = mix (h1);
+		h2 = mix (h2);
+		
+		h1 += h2;
+		h2 += h1;
+		
+		Hash hash;
+		hash.low = h1;
+		hash.high = h2;
+		return hash;
+	}
+
+}
@@ -23,8 +23,13 @@ THE SOFTWARE.
 #include "Input.h"
 
 #include <stdexcept>
+#include <cstring>
 #include <ticpp/ticpp.h>
 
+#include "Cache.h"
+#include "Memory.h"
+#include "MappedFile.h"
+
 
 namespace ColladaParser
 {
@@ -40,6 +45,21 @@ namespace ColladaParser
 	
 	
 	
+	/* constructor */
+	Input::Input (CacheReader& reader, SourceMap &sources)
+	{
+		mSource = 0;
+		mIndices = 0;
+		
+		mSemantic = InputSemantic (reader.read<uint32_t> ());
+		mOffset   = reader.read<uint32_t> ();
+		mURL      = StringPool::getCurrent()->intern (reader.readString (), STRING_URL);
+		
+		attach (sources);
+	}
+	
+	
+	
 	/* destructor */
 	Input::~Input ()
 	{
@@ -83,27 +103,144 @@ namespace ColladaParser
 	
 	
 	
+	/* hash the input layout and its source */
+	Hash Input::getHash ()
+	{
+		Hasher hasher;
+		hasher.add (int (mSemantic));
+		hasher.add (mOffset);
+		hasher.add (mSource->getHash());
+		return hasher.getHash();
+	}
+	
+	
+	/* compare the input layout and its source */
+	bool Input::isEqual (DataSource* source)
+	{
+		Input* input = dynamic_cast<Input*> (source);
+		
+		if (!input || mSemantic != input->mSemantic || mOffset != input->mOffset)
+			return false;
+		
+		return mSource->isEqual (input->mSource);
+	}
+	
+	
+	/* compare the index data and stride */
+	bool Indices::isEqual (const Indices& indices) const
+	{
+		if (mStride != indices.mStride || mSize != indices.mSize)
+			return false;
+		
+		return mSize == 0 || std::memcmp (mData, indices.mData, getDataSize()) == 0;
+	}
+	
+	
+	
+	
 	void Input::parse (ticpp::Element *element, SourceMap &sources)
 	{
 		/* get input properties */
-		std::string uri = element->GetAttribute ("source");
+		mURL = StringPool::getCurrent()->intern (element->GetAttribute ("source"), STRING_URL);
 		std::string semantic = element->GetAttribute ("semantic");
 		element->GetAttributeOrDefault ("offset", &mOffset, 0);
 		
 		
 		mSemantic = parseSemantic (semantic);
 		
-		
+		attach (sources);
+	}
+	
+	
+	/* attach input to its source */
+	void Input::attach (SourceMap &sources)
+	{
 		/* couldn't find input source */
-		if (sources.find (uri) == sources.end())
+		if (sources.find (mURL) == sources.end())
 		{
-			std::string error = "Parsing failed: No source named '" + uri + "' found";
+			std::string error = "Parsing failed: No source named '" + mURL.str() + "' found";
 			throw std::runtime_error (error.c_str());
 		}
 		
 		
-		/* attach input to source */
-		mSource = sources[uri];
+		mSource = sources[mURL.str()];
+	}
+	
+	
+	
+	/* write the input layout, the source is written by the geometry */
+	void Input::write (CacheWriter& writer) const
+	{
+		writer.write (uint32_t (mSemantic));
+		writer.write (uint32_t (mOffset));
+		writer.writeString (mURL);
+	}
+	
+	
+	
+	/* read index data */
+	void Indices::read (CacheReader& reader)
+	{
+		mStride = reader.read<int32_t> ();
+		
+		/* use the array in place. the capacity ends with the data so
+		 * adding to it copies out of the read only mapping first */
+		size_t size;
+		mData = static_cast<int*> (const_cast<void*> (reader.readArray (size)));
+		mSize = size / sizeof (int);
+		mCapacity = mSize;
+		
+		mIndices.clear ();
+		mBuffer.reset ();
+		mMapping = reader.getFile ();
+	}
+	
+	
+	/* grow the storage, moving to a mapped buffer once large enough */
+	void Indices::reserve (size_t size)
+	{
+		if (size <= mCapacity)
+			return;
+		
+		std::shared_ptr<MappedBuffer> buffer = MemoryTracker::createBuffer (size * sizeof (int));
+		
+		if (buffer)
+		{
+			int* data = static_cast<int*> (buffer->getData());
+			
+			if (mSize > 0)
+				std::memcpy (data, mData, getDataSize());
+			
+			mIndices.clear ();
+			mIndices.shrink_to_fit ();
+			
+			mBuffer = buffer;
+			mMapping.reset ();
+			mData = data;
+		}
+		
+		else
+		{
+			std::vector<int, ContainerAllocator<int> > indices (size, 0, mIndices.get_allocator());
+			
+			if (mSize > 0)
+				std::memcpy (&indices[0], mData, getDataSize());
+			
+			mIndices.swap (indices);
+			mBuffer.reset ();
+			mMapping.reset ();
+			mData = &mIndices[0];
+		}
+		
+		mCapacity = size;
+	}
+	
+	
+	/* write index data */
+	void Indices::write (CacheWriter& writer) const
+	{
+		writer.write (int32_t (mStride));
+		writer.writeArray (mData, getDataSize());
 	}
 	
 	
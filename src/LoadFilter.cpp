@@ -0,0 +1,173 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "LoadFilter.h"
+
+#include <sstream>
+
+
+namespace ColladaParser
+{
+
+	/* constructor */
+	LoadFilter::LoadFilter ()
+	{
+	}
+	
+	
+	
+	
+	/* add an id to load */
+	void LoadFilter::addID (LibraryType type, const std::string& id)
+	{
+		mIDs[type].insert ((!id.empty() && id[0] == '#') ? id.substr (1) : id);
+	}
+	
+	
+	/* add a node layer to load */
+	void LoadFilter::addLayer (const std::string& layer)
+	{
+		mLayers.insert (layer);
+	}
+	
+	
+	
+	
+	/* accepts everything */
+	bool LoadFilter::isEmpty () const
+	{
+		if (mPredicate || !mLayers.empty())
+			return false;
+		
+		for (int i = 0; i < LIBRARY_COUNT; i++)
+		{
+			if (!mIDs[i].empty())
+				return false;
+		}
+		
+		return true;
+	}
+	
+	
+	/* whether an element should be loaded */
+	bool LoadFilter::accepts (LibraryType type, const std::string& id) const
+	{
+		if (!mIDs[type].empty() && mIDs[type].find (id) == mIDs[type].end())
+			return false;
+		
+		return !mPredicate || mPredicate (type, id);
+	}
+	
+	
+	/* whether a node should be loaded */
+	bool LoadFilter::acceptsLayers (const std::string& layers) const
+	{
+		if (mLayers.empty())
+			return true;
+		
+		
+		std::istringstream stream (layers);
+		std::string layer;
+		bool layered = false;
+		
+		while (stream >> layer)
+		{
+			if (mLayers.find (layer) != mLayers.end())
+				return true;
+			
+			layered = true;
+		}
+		
+		/* nodes without a layer are kept */
+		return !layered;
+	}
+	
+	
+	
+	
+	/* collect rejected nodes */
+	void LoadFilter::findRejected (const Scanner& scanner, const Scanner::Element& element, RangeList& rejected) const
+	{
+		std::vector<Scanner::Element> children;
+		scanner.getChildren (element, children);
+		
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			if (children[i].name != "node")
+				continue;
+			
+			if (acceptsLayers (scanner.getAttribute (children[i], "layer")))
+				findRejected (scanner, children[i], rejected);
+			else
+				rejected.push_back (std::make_pair (children[i].begin, children[i].end));
+		}
+	}
+	
+	
+	
+	/* visual scene text without rejected nodes */
+	std::string LoadFilter::filterScene (const Scanner& scanner, const Scanner::Element& scene) const
+	{
+		if (mLayers.empty())
+			return scanner.getSource (scene);
+		
+		
+		RangeList rejected;
+		findRejected (scanner, scene, rejected);
+		
+		if (rejected.empty())
+			return scanner.getSource (scene);
+		
+		
+		/* a scene needs at least one of its own nodes */
+		std::vector<Scanner::Element> children;
+		scanner.getChildren (scene, children);
+		
+		bool kept = false;
+		
+		for (size_t i = 0; i < children.size() && !kept; i++)
+		{
+			if (children[i].name == "node")
+				kept = acceptsLayers (scanner.getAttribute (children[i], "layer"));
+		}
+		
+		if (!kept)
+			return std::string ();
+		
+		
+		/* copy the text between the rejected ranges, which are in
+		 * document order since the scan is depth first */
+		std::string text;
+		size_t pos = scene.begin;
+		
+		for (size_t r = 0; r < rejected.size(); r++)
+		{
+			text.append (scanner.getData() + pos, rejected[r].first - pos);
+			pos = rejected[r].second;
+		}
+		
+		text.append (scanner.getData() + pos, scene.end - pos);
+		return text;
+	}
+
+}
@@ -0,0 +1,164 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "MappedFile.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+
+namespace ColladaParser
+{
+
+	/* constructor */
+	MappedFile::MappedFile (const std::string& file)
+	: mData (0),
+	  mSize (0),
+	  mMapped (false)
+	{
+#ifndef _WIN32
+		int fd = ::open (file.c_str(), O_RDONLY);
+		
+		if (fd >= 0)
+		{
+			struct stat info;
+			
+			if (fstat (fd, &info) == 0 && info.st_size > 0)
+			{
+				void* data = mmap (0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				
+				if (data != MAP_FAILED)
+				{
+					mData = static_cast<const char*> (data);
+					mSize = info.st_size;
+					mMapped = true;
+				}
+			}
+			
+			::close (fd);
+			
+			if (mMapped)
+				return;
+		}
+#endif
+		
+		
+		/* fall back to reading the whole file */
+		std::ifstream stream (file.c_str(), std::ios::in | std::ios::binary);
+		
+		if (!stream)
+		{
+			std::string error = "Failed to open file '" + file + "'";
+			throw std::runtime_error (error.c_str());
+		}
+		
+		stream.seekg (0, std::ios::end);
+		mBuffer.resize (stream.tellg());
+		stream.seekg (0, std::ios::beg);
+		
+		if (!mBuffer.empty())
+			stream.read (&mBuffer[0], mBuffer.size());
+		
+		mData = mBuffer.empty() ? 0 : &mBuffer[0];
+		mSize = mBuffer.size();
+	}
+	
+	
+	/* destructor */
+	MappedFile::~MappedFile ()
+	{
+#ifndef _WIN32
+		if (mMapped)
+			munmap (const_cast<char*> (mData), mSize);
+#endif
+	}
+
+	
+	
+	
+	
+	/* constructor */
+	MappedBuffer::MappedBuffer (size_t size, const std::string& directory)
+	: mData (0),
+	  mSize (size),
+	  mMapped (false)
+	{
+		if (size == 0)
+			return;
+		
+#ifndef _WIN32
+		void* data = MAP_FAILED;
+		
+		if (directory.empty())
+			data = mmap (0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+		
+		else
+		{
+			/* the file goes away with the mapping */
+			std::string path = directory + "/colladaXXXXXX";
+			int fd = mkstemp (&path[0]);
+			
+			if (fd >= 0)
+			{
+				::unlink (path.c_str());
+				
+				if (ftruncate (fd, size) == 0)
+					data = mmap (0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				
+				::close (fd);
+			}
+		}
+		
+		if (data == MAP_FAILED)
+		{
+			std::string error = "Failed to map temporary storage in '" + directory + "'";
+			throw std::runtime_error (error.c_str());
+		}
+		
+		mData = data;
+		mMapped = true;
+#else
+		mBuffer.resize (size);
+		mData = &mBuffer[0];
+#endif
+	}
+	
+	
+	/* destructor */
+	MappedBuffer::~MappedBuffer ()
+	{
+#ifndef _WIN32
+		if (mMapped)
+			munmap (mData, mSize);
+#endif
+	}
+
+}
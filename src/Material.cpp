@@ -25,17 +25,33 @@ THE SOFTWARE.
 #include <stdexcept>
 #include <ticpp/ticpp.h>
 
+#include "Cache.h"
+
 
 namespace ColladaParser
 {
 
 	/* constructor */
 	Material::Material (ticpp::Element* element)
+	: mStrings (StringPool::acquire ())
 	{
 		parse (element);
 	}
 	
 	
+	/* constructor */
+	Material::Material (CacheReader& reader)
+	: mStrings (StringPool::acquire ())
+	{
+		mID   = mStrings->intern (reader.readString (), STRING_ID);
+		mName = mStrings->intern (reader.readString (), STRING_NAME);
+		
+		mEffect.sid  = mStrings->intern (reader.readString (), STRING_SID);
+		mEffect.name = mStrings->intern (reader.readString (), STRING_NAME);
+		mEffect.url  = mStrings->intern (reader.readString (), STRING_URL);
+	}
+	
+	
 	/* destructor */
 	Material::~Material ()
 	{
@@ -44,6 +60,19 @@ namespace ColladaParser
 	
 	
 	
+	/* write material, the effect is resolved again when read */
+	void Material::write (CacheWriter& writer) const
+	{
+		writer.writeString (mID);
+		writer.writeString (mName);
+		
+		writer.writeString (mEffect.sid);
+		writer.writeString (mEffect.name);
+		writer.writeString (mEffect.url);
+	}
+	
+	
+	
 	
 	/* parse material element */
 	void Material::parse (ticpp::Element* element)
@@ -52,8 +81,8 @@ namespace ColladaParser
 		
 		
 		/* material properties */
-		mID   = element->GetAttributeOrDefault ("id", "");
-		mName = element->GetAttributeOrDefault ("name", "");
+		mID   = mStrings->intern (element->GetAttributeOrDefault ("id", ""), STRING_ID);
+		mName = mStrings->intern (element->GetAttributeOrDefault ("name", ""), STRING_NAME);
 		
 		
 		/* sift through material elements
@@ -76,9 +105,9 @@ namespace ColladaParser
 	void Material::parseEffect (ticpp::Element* element)
 	{
 		/* effect properties */
-		mEffect.sid  = element->GetAttributeOrDefault ("sid", "");
-		mEffect.name = element->GetAttributeOrDefault ("name", "");
-		mEffect.url  = element->GetAttribute ("url");
+		mEffect.sid  = mStrings->intern (element->GetAttributeOrDefault ("sid", ""), STRING_SID);
+		mEffect.name = mStrings->intern (element->GetAttributeOrDefault ("name", ""), STRING_NAME);
+		mEffect.url  = mStrings->intern (element->GetAttribute ("url"), STRING_URL);
 	}
 
 }
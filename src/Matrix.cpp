@@ -0,0 +1,243 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "Matrix.h"
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define COLLADA_PARSER_USE_SSE
+#endif
+
+
+namespace ColladaParser
+{
+
+	/* degrees to radians */
+	static const float DEG_TO_RAD = 3.14159265358979323846f / 180.0f;
+	
+	
+	
+	/* vector helpers */
+	static Vector normalise (const Vector& vec)
+	{
+		float length = std::sqrt (vec.x * vec.x + vec.y * vec.y + vec.z * vec.z);
+		Vector result = vec;
+		
+		if (length > 0)
+		{
+			result.x /= length;
+			result.y /= length;
+			result.z /= length;
+		}
+		
+		return result;
+	}
+	
+	
+	static Vector cross (const Vector& a, const Vector& b)
+	{
+		Vector result;
+		result.x = a.y * b.z - a.z * b.y;
+		result.y = a.z * b.x - a.x * b.z;
+		result.z = a.x * b.y - a.y * b.x;
+		return result;
+	}
+	
+	
+	
+	
+	/* transform point */
+	Vector Matrix::transformPoint (const Vector& point) const
+	{
+		Vector result;
+		result.x = m[0] * point.x + m[4] * point.y + m[8]  * point.z + m[12];
+		result.y = m[1] * point.x + m[5] * point.y + m[9]  * point.z + m[13];
+		result.z = m[2] * point.x + m[6] * point.y + m[10] * point.z + m[14];
+		return result;
+	}
+	
+	
+	/* transform direction */
+	Vector Matrix::transformVector (const Vector& vector) const
+	{
+		Vector result;
+		result.x = m[0] * vector.x + m[4] * vector.y + m[8]  * vector.z;
+		result.y = m[1] * vector.x + m[5] * vector.y + m[9]  * vector.z;
+		result.z = m[2] * vector.x + m[6] * vector.y + m[10] * vector.z;
+		return result;
+	}
+	
+	
+	
+	
+	/* identity matrix */
+	Matrix Matrix::identity ()
+	{
+		Matrix mat;
+		
+		for (int i = 0; i < 16; i++)
+			mat.m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+		
+		return mat;
+	}
+	
+	
+	/* translation matrix */
+	Matrix Matrix::translation (const Vector& offset)
+	{
+		Matrix mat = identity ();
+		mat(0,3) = offset.x;
+		mat(1,3) = offset.y;
+		mat(2,3) = offset.z;
+		return mat;
+	}
+	
+	
+	/* scale matrix */
+	Matrix Matrix::scale (const Vector& factor)
+	{
+		Matrix mat = identity ();
+		mat(0,0) = factor.x;
+		mat(1,1) = factor.y;
+		mat(2,2) = factor.z;
+		return mat;
+	}
+	
+	
+	/* rotation about an arbitrary axis */
+	Matrix Matrix::rotation (const Vector& axis, float degrees)
+	{
+		Matrix mat = identity ();
+		Vector a = normalise (axis);
+		
+		float angle = degrees * DEG_TO_RAD;
+		float c = std::cos (angle);
+		float s = std::sin (angle);
+		float t = 1.0f - c;
+		
+		mat(0,0) = t * a.x * a.x + c;
+		mat(0,1) = t * a.x * a.y - s * a.z;
+		mat(0,2) = t * a.x * a.z + s * a.y;
+		
+		mat(1,0) = t * a.x * a.y + s * a.z;
+		mat(1,1) = t * a.y * a.y + c;
+		mat(1,2) = t * a.y * a.z - s * a.x;
+		
+		mat(2,0) = t * a.x * a.z - s * a.y;
+		mat(2,1) = t * a.y * a.z + s * a.x;
+		mat(2,2) = t * a.z * a.z + c;
+		
+		return mat;
+	}
+	
+	
+	/* position and orient an object looking at a point of interest */
+	Matrix Matrix::lookAt (const Vector& eye, const Vector& interest, const Vector& up)
+	{
+		Matrix mat = identity ();
+		
+		Vector dir;
+		dir.x = interest.x - eye.x;
+		dir.y = interest.y - eye.y;
+		dir.z = interest.z - eye.z;
+		dir = normalise (dir);
+		
+		Vector side = normalise (cross (dir, up));
+		Vector top  = cross (side, dir);
+		
+		/* the object looks down its negative z axis */
+		mat(0,0) = side.x; mat(0,1) = top.x; mat(0,2) = -dir.x; mat(0,3) = eye.x;
+		mat(1,0) = side.y; mat(1,1) = top.y; mat(1,2) = -dir.y; mat(1,3) = eye.y;
+		mat(2,0) = side.z; mat(2,1) = top.z; mat(2,2) = -dir.z; mat(2,3) = eye.z;
+		
+		return mat;
+	}
+	
+	
+	/* RenderMan style skew. points are moved along the translation axis
+	 * in proportion to their distance along the rotation axis */
+	Matrix Matrix::skew (float degrees, const Vector& rotation, const Vector& translation)
+	{
+		Matrix mat = identity ();
+		
+		Vector a = normalise (rotation);
+		Vector b = normalise (translation);
+		float s = std::tan (degrees * DEG_TO_RAD);
+		
+		mat(0,0) += s * b.x * a.x; mat(0,1) += s * b.x * a.y; mat(0,2) += s * b.x * a.z;
+		mat(1,0) += s * b.y * a.x; mat(1,1) += s * b.y * a.y; mat(1,2) += s * b.y * a.z;
+		mat(2,0) += s * b.z * a.x; mat(2,1) += s * b.z * a.y; mat(2,2) += s * b.z * a.z;
+		
+		return mat;
+	}
+	
+	
+	
+	
+	/* matrix concatenation */
+	void multiply (const Matrix& lhs, const Matrix& rhs, Matrix& result)
+	{
+#ifdef COLLADA_PARSER_USE_SSE
+		__m128 c0 = _mm_load_ps (lhs.m);
+		__m128 c1 = _mm_load_ps (lhs.m + 4);
+		__m128 c2 = _mm_load_ps (lhs.m + 8);
+		__m128 c3 = _mm_load_ps (lhs.m + 12);
+		
+		/* each result column is a linear combination of the lhs columns */
+		for (int col = 0; col < 4; col++)
+		{
+			const float* r = rhs.m + col * 4;
+			
+			__m128 sum = _mm_mul_ps (c0, _mm_set1_ps (r[0]));
+			sum = _mm_add_ps (sum, _mm_mul_ps (c1, _mm_set1_ps (r[1])));
+			sum = _mm_add_ps (sum, _mm_mul_ps (c2, _mm_set1_ps (r[2])));
+			sum = _mm_add_ps (sum, _mm_mul_ps (c3, _mm_set1_ps (r[3])));
+			
+			_mm_store_ps (result.m + col * 4, sum);
+		}
+#else
+		for (int col = 0; col < 4; col++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				result.m[col * 4 + row] =
+						lhs.m[row]      * rhs.m[col * 4]     +
+						lhs.m[row + 4]  * rhs.m[col * 4 + 1] +
+						lhs.m[row + 8]  * rhs.m[col * 4 + 2] +
+						lhs.m[row + 12] * rhs.m[col * 4 + 3];
+			}
+		}
+#endif
+	}
+	
+	
+	Matrix operator* (const Matrix& lhs, const Matrix& rhs)
+	{
+		Matrix result;
+		multiply (lhs, rhs, result);
+		return result;
+	}
+
+}
@@ -0,0 +1,445 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+
+
+#include "Memory.h"
+
+#include <sstream>
+
+#include "Material.h"
+#include "Effect.h"
+#include "Geometry.h"
+#include "VisualScene.h"
+#include "Transform.h"
+#include "MappedFile.h"
+
+
+namespace ColladaParser
+{
+
+	thread_local MemoryTracker* MemoryTracker::sCurrent = 0;
+	
+	
+	/* bookkeeping of a tree based container entry */
+	static const size_t MAP_NODE = 4 * sizeof (void*);
+	
+	static const char* CATEGORY_NAMES[MEMORY_CATEGORY_COUNT] =
+	{
+		"XML tree", "document text", "source data", "index data",
+		"strings", "nodes", "elements"
+	};
+	
+	
+	
+	/* describe the failed allocation */
+	static std::string describe (MemoryCategory category, size_t requested, size_t held, size_t budget)
+	{
+		std::ostringstream stream;
+		
+		stream << "Memory budget exceeded: " << requested << " bytes of " << CATEGORY_NAMES[category]
+		       << " requested with " << held << " of " << budget << " bytes held";
+		
+		return stream.str();
+	}
+	
+	
+	/* constructor */
+	MemoryBudgetExceeded::MemoryBudgetExceeded (MemoryCategory category, size_t requested, size_t held, size_t budget)
+	: std::runtime_error (describe (category, requested, held, budget)),
+	  mCategory (category),
+	  mRequested (requested),
+	  mHeld (held),
+	  mBudget (budget)
+	{
+	}
+	
+	
+	
+	/* constructor */
+	MemoryStats::MemoryStats () : mapped(0), peak(0)
+	{
+		for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+			peaks[i] = 0;
+	}
+	
+	
+	/* total bytes */
+	size_t MemoryStats::getBytes () const
+	{
+		size_t bytes = 0;
+		
+		for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+			bytes += categories[i].bytes;
+		
+		return bytes;
+	}
+	
+	
+	
+	
+	/* add to a category and library */
+	void MemoryCounter::add (MemoryCategory category, LibraryType library, size_t bytes, size_t count)
+	{
+		mStats.categories[category].bytes += bytes;
+		mStats.categories[category].count += count;
+		
+		if (library != LIBRARY_COUNT)
+			mStats.libraries[library].bytes += bytes;
+	}
+	
+	
+	
+	/* material */
+	void MemoryCounter::add (const Material*)
+	{
+		mStats.libraries[LIBRARY_MATERIALS].count++;
+		add (MEMORY_ELEMENTS, LIBRARY_MATERIALS, sizeof (Material), 1);
+	}
+	
+	
+	/* effect and its profiles */
+	void MemoryCounter::add (const Effect* effect)
+	{
+		size_t profiles = effect->getCommonProfiles().size();
+		
+		mStats.libraries[LIBRARY_EFFECTS].count++;
+		add (MEMORY_ELEMENTS, LIBRARY_EFFECTS, sizeof (Effect) + profiles * (sizeof (ProfileCommon) + sizeof (void*)), 1);
+	}
+	
+	
+	/* geometry with its sources and primitives */
+	void MemoryCounter::add (const Geometry* geometry)
+	{
+		const SourceMap& sources = geometry->getSources ();
+		const std::vector<Primitive*>& primitives = geometry->getPrimitives ();
+		
+		mStats.libraries[LIBRARY_GEOMETRIES].count++;
+		
+		size_t bytes = sizeof (Geometry) + sources.size() * (MAP_NODE + sizeof (SourceMap::value_type));
+		
+		
+		for (SourceMap::const_iterator iter = sources.begin(); iter != sources.end(); ++iter)
+		{
+			const Source* source = dynamic_cast<const Source*> (iter->second);
+			
+			/* the vertices input */
+			if (!source)
+			{
+				bytes += sizeof (Input);
+				continue;
+			}
+			
+			add (MEMORY_SOURCES, LIBRARY_GEOMETRIES, sizeof (Source), 1);
+			
+			
+			/* arrays shared by deduplicated sources are counted once */
+			const Source::Array* array = source->mData.get();
+			
+			if (!mCounted.insert (array).second)
+				continue;
+			
+			if (array->mapping)
+				addMapping (array->mapping.get());
+			
+			if (array->buffer)
+				addMapping (array->buffer.get());
+			
+			/* arrays still to be decoded are charged their decoded size up
+			 * front, the decode on first access happens outside any parse */
+			size_t values = array->decoded.load (std::memory_order_acquire) ? array->values.capacity() : array->count;
+			
+			add (MEMORY_SOURCES, LIBRARY_GEOMETRIES, sizeof (Source::Array) + array->text.capacity() +
+				values * sizeof (float), 0);
+		}
+		
+		
+		for (size_t i = 0; i < primitives.size(); i++)
+		{
+			const Indices* indices = primitives[i]->mIndices;
+			bytes += sizeof (Primitive) + sizeof (void*);
+			
+			/* indices kept out of core or read from a cache are mapped */
+			if (indices->mBuffer)
+			{
+				addMapping (indices->mBuffer.get());
+				add (MEMORY_INDICES, LIBRARY_GEOMETRIES, sizeof (Indices), 1);
+			}
+			else if (indices->mMapping)
+			{
+				addMapping (indices->mMapping.get());
+				add (MEMORY_INDICES, LIBRARY_GEOMETRIES, sizeof (Indices), 1);
+			}
+			else
+				add (MEMORY_INDICES, LIBRARY_GEOMETRIES, sizeof (Indices) + indices->mCapacity * sizeof (int), 1);
+		}
+		
+		add (MEMORY_ELEMENTS, LIBRARY_GEOMETRIES, bytes, 1);
+	}
+	
+	
+	/* visual scene and its node tree */
+	void MemoryCounter::add (const VisualScene* scene)
+	{
+		const NodeList& nodes = scene->getNodes ();
+		
+		mStats.libraries[LIBRARY_VISUAL_SCENES].count++;
+		add (MEMORY_ELEMENTS, LIBRARY_VISUAL_SCENES, sizeof (VisualScene), 1);
+		
+		for (size_t i = 0; i < nodes.size(); i++)
+			add (nodes[i], LIBRARY_VISUAL_SCENES);
+	}
+	
+	
+	/* node tree */
+	void MemoryCounter::add (const Node* node, LibraryType library)
+	{
+		const GeometryInstanceList& instances = node->getGeometries ();
+		const NodeList& children = node->getChildren ();
+		
+		size_t bytes = sizeof (Node) + sizeof (void*);
+		bytes += node->getTransforms().size() * (sizeof (Transform) + sizeof (void*));
+		bytes += node->getLayers().size() * sizeof (std::string);
+		
+		for (size_t i = 0; i < instances.size(); i++)
+		{
+			bytes += sizeof (GeometryInstance) + sizeof (void*);
+			
+			if (const MaterialBinding* binding = instances[i]->materials)
+			{
+				bytes += sizeof (MaterialBinding);
+				bytes += binding->materials.size() * (MAP_NODE + sizeof (StringMap::value_type));
+				bytes += binding->targets.size() * (MAP_NODE + sizeof (MaterialMap::value_type));
+			}
+		}
+		
+		add (MEMORY_NODES, library, bytes, 1);
+		
+		for (size_t i = 0; i < children.size(); i++)
+			add (children[i], library);
+	}
+	
+	
+	/* element of any library */
+	void MemoryCounter::add (LibraryType library, const void* element)
+	{
+		switch (library)
+		{
+		case LIBRARY_MATERIALS:     add (static_cast<const Material*> (element));    break;
+		case LIBRARY_EFFECTS:       add (static_cast<const Effect*> (element));      break;
+		case LIBRARY_GEOMETRIES:    add (static_cast<const Geometry*> (element));    break;
+		case LIBRARY_VISUAL_SCENES: add (static_cast<const VisualScene*> (element)); break;
+		default: break;
+		}
+	}
+	
+	
+	
+	/* document text of an unparsed element */
+	void MemoryCounter::addText (size_t bytes)
+	{
+		add (MEMORY_TEXT, LIBRARY_COUNT, bytes, 1);
+	}
+	
+	
+	/* string pool */
+	void MemoryCounter::addStrings (const StringStats& strings)
+	{
+		add (MEMORY_STRINGS, LIBRARY_COUNT, strings.getBytes(), strings.getStrings());
+	}
+	
+	
+	/* mapped file, counted once */
+	void MemoryCounter::addMapping (const MappedFile* file)
+	{
+		if (mCounted.insert (file).second)
+			mStats.mapped += file->getSize();
+	}
+	
+	
+	/* out of core array, counted once */
+	void MemoryCounter::addMapping (const MappedBuffer* buffer)
+	{
+		if (mCounted.insert (buffer).second)
+			mStats.mapped += buffer->getSize();
+	}
+	
+	
+	
+	
+	/* raise a peak to the given value */
+	static void raise (std::atomic<size_t>& peak, size_t value)
+	{
+		size_t current = peak.load (std::memory_order_relaxed);
+		
+		while (current < value && !peak.compare_exchange_weak (current, value, std::memory_order_relaxed))
+			;
+	}
+	
+	
+	
+	/* constructor */
+	MemoryTracker::MemoryTracker () : mBudget(0), mOutOfCore(0)
+	{
+		reset ();
+	}
+	
+	
+	/* start over */
+	void MemoryTracker::reset ()
+	{
+		mTotal.store (0);
+		mPeak.store (0);
+		
+		for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+		{
+			mCurrent[i].store (0);
+			mPeaks[i].store (0);
+		}
+	}
+	
+	
+	
+	/* memory taken */
+	void MemoryTracker::allocate (MemoryCategory category, size_t bytes)
+	{
+		size_t budget = mBudget.load (std::memory_order_relaxed);
+		size_t total = mTotal.fetch_add (bytes, std::memory_order_relaxed) + bytes;
+		
+		if (budget > 0 && total > budget)
+		{
+			mTotal.fetch_sub (bytes, std::memory_order_relaxed);
+			throw MemoryBudgetExceeded (category, bytes, total - bytes, budget);
+		}
+		
+		raise (mPeaks[category], mCurrent[category].fetch_add (bytes, std::memory_order_relaxed) + bytes);
+		raise (mPeak, total);
+	}
+	
+	
+	/* memory given back */
+	void MemoryTracker::release (MemoryCategory category, size_t bytes)
+	{
+		mCurrent[category].fetch_sub (bytes, std::memory_order_relaxed);
+		mTotal.fetch_sub (bytes, std::memory_order_relaxed);
+	}
+	
+	
+	
+	/* every category, nothing is taken when one doesn't fit */
+	void MemoryTracker::allocate (const MemoryStats& stats)
+	{
+		int i = 0;
+		
+		try
+		{
+			for (; i < MEMORY_CATEGORY_COUNT; i++)
+			{
+				if (stats.categories[i].bytes > 0)
+					allocate (MemoryCategory (i), stats.categories[i].bytes);
+			}
+		}
+		catch (...)
+		{
+			while (i-- > 0)
+			{
+				if (stats.categories[i].bytes > 0)
+					release (MemoryCategory (i), stats.categories[i].bytes);
+			}
+			
+			throw;
+		}
+	}
+	
+	
+	/* every category */
+	void MemoryTracker::release (const MemoryStats& stats)
+	{
+		for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+		{
+			if (stats.categories[i].bytes > 0)
+				release (MemoryCategory (i), stats.categories[i].bytes);
+		}
+	}
+	
+	
+	
+	/* check memory would fit */
+	void MemoryTracker::predict (MemoryCategory category, size_t bytes) const
+	{
+		size_t budget = mBudget.load (std::memory_order_relaxed);
+		size_t held = mTotal.load (std::memory_order_relaxed);
+		size_t threshold = mOutOfCore.load (std::memory_order_relaxed);
+		
+		/* mapped arrays aren't held on the heap */
+		if ((category == MEMORY_SOURCES || category == MEMORY_INDICES) && threshold > 0 && bytes >= threshold)
+			return;
+		
+		if (budget > 0 && held + bytes > budget)
+			throw MemoryBudgetExceeded (category, bytes, held, budget);
+	}
+	
+	
+	
+	/* out of core threshold */
+	void MemoryTracker::setOutOfCore (size_t bytes, const std::string& directory)
+	{
+		std::lock_guard<std::mutex> lock (mMutex);
+		
+		mDirectory = directory;
+		mOutOfCore.store (bytes);
+	}
+	
+	
+	/* mapped storage for large arrays */
+	std::shared_ptr<MappedBuffer> MemoryTracker::map (size_t bytes) const
+	{
+		size_t threshold = mOutOfCore.load (std::memory_order_relaxed);
+		
+		if (threshold == 0 || bytes < threshold)
+			return std::shared_ptr<MappedBuffer>();
+		
+		std::string directory;
+		{
+			std::lock_guard<std::mutex> lock (mMutex);
+			directory = mDirectory;
+		}
+		
+		return std::make_shared<MappedBuffer> (bytes, directory);
+	}
+	
+	
+	
+	/* peaks */
+	void MemoryTracker::getPeaks (MemoryStats& stats) const
+	{
+		size_t strings = stats.categories[MEMORY_STRINGS].bytes;
+		
+		for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+			stats.peaks[i] = mPeaks[i].load ();
+		
+		stats.peaks[MEMORY_STRINGS] = strings;
+		stats.peak = mPeak.load() + strings;
+	}
+
+}
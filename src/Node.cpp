@@ -26,21 +26,87 @@ THE SOFTWARE.
 #include <ticpp/ticpp.h>
 
 #include "Transform.h"
+#include "TransformEvaluator.h"
+#include "Document.h"
+#include "Cache.h"
 #include <iostream>
 
 namespace ColladaParser
 {
 
 	/* constructor */
-	Node::Node (ticpp::Element *element)
+	Node::Node (ticpp::Element *element) : mParent(0), mRevision(0)
 	{
-		parse (element);
+		try
+		{
+			parse (element);
+		}
+		catch (...)
+		{
+			release ();
+			throw;
+		}
 	}
 	
 	
 	
 	/* destructor */
 	Node::~Node ()
+	{
+		release ();
+	}
+	
+	
+	/* take ownership of a transform */
+	void Node::addTransform (Transform* transform)
+	{
+		transform->mNode = this;
+		mTransforms.push_back (transform);
+	}
+	
+	
+	/* resolve a lazy instance */
+	void GeometryInstance::resolve () const
+	{
+		if (document && !resolved.load (std::memory_order_acquire))
+			document->resolve (this);
+	}
+	
+	
+	/* instanced geometry */
+	Geometry* GeometryInstance::getGeometry () const
+	{
+		resolve ();
+		return geometry;
+	}
+	
+	
+	/* bound material */
+	Material* GeometryInstance::getMaterial (const std::string& symbol) const
+	{
+		resolve ();
+		
+		if (!materials)
+			return 0;
+		
+		MaterialMap::const_iterator found = materials->targets.find (symbol);
+		return found == materials->targets.end() ? 0 : found->second;
+	}
+	
+	
+	
+	/* flag the node and tell its evaluators */
+	void Node::changed ()
+	{
+		mRevision++;
+		
+		for (size_t i = 0; i < mEvaluators.size(); i++)
+			mEvaluators[i]->invalidate (this);
+	}
+	
+	
+	/* free transforms, instances and children */
+	void Node::release ()
 	{
 		/* free transforms */
 		TransformList::iterator iter;
@@ -49,6 +115,14 @@ namespace ColladaParser
 			delete *iter;
 		
 		
+		/* free geometry instances */
+		for (size_t i = 0; i < mGeometries.size(); i++)
+		{
+			delete mGeometries[i]->materials;
+			delete mGeometries[i];
+		}
+		
+		
 		/* free children */
 		NodeList::iterator it;
 		
@@ -59,13 +133,140 @@ namespace ColladaParser
 	
 	
 	
+	/* constructor */
+	Node::Node (CacheReader& reader) : mParent(0), mRevision(0)
+	{
+		try
+		{
+			StringPool* strings = StringPool::getCurrent ();
+			
+			mID   = strings->intern (reader.readString (), STRING_ID);
+			mName = strings->intern (reader.readString (), STRING_NAME);
+			mSID  = strings->intern (reader.readString (), STRING_SID);
+			mType = Type (reader.read<uint32_t> ());
+			
+			mLayers.resize (reader.read<uint32_t> ());
+			
+			for (size_t i = 0; i < mLayers.size(); i++)
+				mLayers[i] = reader.readString ();
+			
+			
+			uint32_t transforms = reader.read<uint32_t> ();
+			
+			for (uint32_t i = 0; i < transforms; i++)
+				addTransform (new Transform (reader));
+			
+			
+			uint32_t instances = reader.read<uint32_t> ();
+			
+			for (uint32_t i = 0; i < instances; i++)
+			{
+				GeometryInstance* instance = new GeometryInstance ();
+				mGeometries.push_back (instance);
+				
+				instance->sid  = strings->intern (reader.readString (), STRING_SID);
+				instance->name = strings->intern (reader.readString (), STRING_NAME);
+				instance->url  = strings->intern (reader.readString (), STRING_URL);
+				
+				/* bound materials, marked by a count above zero */
+				uint32_t bindings = reader.read<uint32_t> ();
+				
+				if (bindings == 0)
+					continue;
+				
+				instance->materials = new MaterialBinding ();
+				
+				for (uint32_t b = 1; b < bindings; b++)
+				{
+					InternedString symbol = strings->intern (reader.readString (), STRING_SYMBOL);
+					instance->materials->materials[symbol] = strings->intern (reader.readString (), STRING_URL);
+				}
+			}
+		}
+		catch (...)
+		{
+			release ();
+			throw;
+		}
+	}
+	
+	
+	
+	/* write node properties */
+	void Node::write (CacheWriter& writer) const
+	{
+		writer.writeString (mID);
+		writer.writeString (mName);
+		writer.writeString (mSID);
+		writer.write (uint32_t (mType));
+		
+		writer.write (uint32_t (mLayers.size()));
+		
+		for (size_t i = 0; i < mLayers.size(); i++)
+			writer.writeString (mLayers[i]);
+		
+		
+		writer.write (uint32_t (mTransforms.size()));
+		
+		for (size_t i = 0; i < mTransforms.size(); i++)
+			mTransforms[i]->write (writer);
+		
+		
+		writer.write (uint32_t (mGeometries.size()));
+		
+		for (size_t i = 0; i < mGeometries.size(); i++)
+		{
+			const GeometryInstance* instance = mGeometries[i];
+			
+			writer.writeString (instance->sid);
+			writer.writeString (instance->name);
+			writer.writeString (instance->url);
+			
+			if (!instance->materials)
+			{
+				writer.write (uint32_t (0));
+				continue;
+			}
+			
+			const StringMap& materials = instance->materials->materials;
+			writer.write (uint32_t (materials.size() + 1));
+			
+			for (StringMap::const_iterator iter = materials.begin(); iter != materials.end(); ++iter)
+			{
+				writer.writeString (iter->first);
+				writer.writeString (iter->second);
+			}
+		}
+	}
+	
+	
+	
+	
+	/* compose transforms */
+	Matrix Node::getLocalMatrix () const
+	{
+		Matrix local = Matrix::identity ();
+		TransformList::const_iterator iter;
+		
+		/* transforms are post-multiplied in document order */
+		for (iter = mTransforms.begin(); iter != mTransforms.end(); ++iter)
+			local = local * (*iter)->getMatrix();
+		
+		return local;
+	}
+	
+	
+	
+	
 	/* parse node element */
 	void Node::parse (ticpp::Element* element)
 	{
+		StringPool* strings = StringPool::getCurrent ();
+		
 		/* scene properties */
-		mID   = element->GetAttributeOrDefault ("id", "");
-		mName = element->GetAttributeOrDefault ("name", "");
-		mSID  = element->GetAttributeOrDefault ("sid", "");
+		mID   = strings->intern (element->GetAttributeOrDefault ("id", ""), STRING_ID);
+		mName = strings->intern (element->GetAttributeOrDefault ("name", ""), STRING_NAME);
+		mSID  = strings->intern (element->GetAttributeOrDefault ("sid", ""), STRING_SID);
 		
 		std::string type   = element->GetAttributeOrDefault ("type", "NODE");
 		std::string layers = element->GetAttributeOrDefault ("layer", "");
@@ -116,7 +317,7 @@ namespace ColladaParser
 			if (child_name == "rotate")
 			{
 				Transform* trans = new Transform (Transform::ROTATE, child);
-				mTransforms.push_back (trans);
+				addTransform (trans);
 			}
 			
 			
@@ -124,7 +325,7 @@ namespace ColladaParser
 			else if (child_name == "scale")
 			{
 				Transform* trans = new Transform (Transform::SCALE, child);
-				mTransforms.push_back (trans);
+				addTransform (trans);
 			}
 			
 			
@@ -132,7 +333,31 @@ namespace ColladaParser
 			else if (child_name == "translate")
 			{
 				Transform* trans = new Transform (Transform::TRANSLATE, child);
-				mTransforms.push_back (trans);
+				addTransform (trans);
+			}
+			
+			
+			/* found matrix */
+			else if (child_name == "matrix")
+			{
+				Transform* trans = new Transform (Transform::MATRIX, child);
+				addTransform (trans);
+			}
+			
+			
+			/* found look at */
+			else if (child_name == "lookat")
+			{
+				Transform* trans = new Transform (Transform::LOOK_AT, child);
+				addTransform (trans);
+			}
+			
+			
+			/* found skew */
+			else if (child_name == "skew")
+			{
+				Transform* trans = new Transform (Transform::SKEW, child);
+				addTransform (trans);
 			}
 			
 			
@@ -146,7 +371,10 @@ namespace ColladaParser
 			/* found child node */
 			else if (child_name == "node")
 			{
-				mChildren.push_back (new Node (child));
+				Node* node = new Node (child);
+				node->mParent = this;
+				
+				mChildren.push_back (node);
 			}
 		}
 		
@@ -159,12 +387,13 @@ namespace ColladaParser
 	GeometryInstance* Node::parseGeometry (ticpp::Element* element)
 	{
 		GeometryInstance* instance = new GeometryInstance ();
+		StringPool* strings = StringPool::getCurrent ();
 		
 		
 		/* scene properties */
-		instance->sid  = element->GetAttributeOrDefault ("sid", "");
-		instance->name = element->GetAttributeOrDefault ("name", "");
-		instance->url  = element->GetAttribute ("url");
+		instance->sid  = strings->intern (element->GetAttributeOrDefault ("sid", ""), STRING_SID);
+		instance->name = strings->intern (element->GetAttributeOrDefault ("name", ""), STRING_NAME);
+		instance->url  = strings->intern (element->GetAttribute ("url"), STRING_URL);
 		
 		
 		ticpp::Iterator<ticpp::Element> iter;
@@ -190,6 +419,7 @@ namespace ColladaParser
 	MaterialBinding* Node::parseMaterial (ticpp::Element* element)
 	{
 		MaterialBinding* binding = new MaterialBinding ();
+		StringPool* strings = StringPool::getCurrent ();
 		
 		
 		ticpp::Iterator<ticpp::Element> iter;
@@ -212,7 +442,7 @@ namespace ColladaParser
 						std::string symbol = it->GetAttribute ("symbol");
 						std::string target = it->GetAttribute ("target");
 						
-						binding->materials[symbol] = target;
+						binding->materials[strings->intern (symbol, STRING_SYMBOL)] = strings->intern (target, STRING_URL);
 					}
 				}
 				
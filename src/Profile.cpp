@@ -22,9 +22,13 @@ THE SOFTWARE.
 
 #include "Profile.h"
 
+#include <cstring>
+#include <locale>
 #include <stdexcept>
 #include <ticpp/ticpp.h>
 
+#include "Cache.h"
+
 
 namespace ColladaParser
 {
@@ -36,6 +40,26 @@ namespace ColladaParser
 	}
 	
 	
+	/* constructor */
+	ProfileCommon::ProfileCommon (CacheReader& reader)
+	{
+		mID = reader.readString ();
+		mTechnique.id  = reader.readString ();
+		mTechnique.sid = reader.readString ();
+		mParams = reader.readString ();
+		
+		/* shader structures are plain floats and stored as they are */
+		uint8_t shaders = reader.read<uint8_t> ();
+		
+		if (shaders & 1) mTechnique.constant = new Constant (reader.read<Constant> ());
+		if (shaders & 2) mTechnique.lambert  = new Lambert  (reader.read<Lambert> ());
+		if (shaders & 4) mTechnique.phong    = new Phong    (reader.read<Phong> ());
+		if (shaders & 8) mTechnique.blinn    = new Blinn    (reader.read<Blinn> ());
+		
+		mHash = reader.read<Hash> ();
+	}
+	
+	
 	/* destructor */
 	ProfileCommon::~ProfileCommon ()
 	{
@@ -49,16 +73,28 @@ namespace ColladaParser
 	
 	
 	
+	/* append an element as compact text */
+	static void printElement (ticpp::Element* element, std::string& text)
+	{
+		TiXmlPrinter printer;
+		printer.SetStreamPrinting ();
+		
+		element->Accept (&printer);
+		text += printer.CStr ();
+	}
+	
+	
 	/* parse colour element */
 	Colour parseColour (ticpp::Element* element)
 	{
-		Colour colour;
+		Colour colour = {0, 0, 0, 0};
 		ticpp::Element* child = element->FirstChildElement ();
 		
 		/* found colour */
 		if (child->Value() == "color")
 		{
 			std::istringstream stream (child->GetText());
+			stream.imbue (std::locale::classic ());
 			
 			stream >> colour.r;
 			stream >> colour.g;
@@ -73,12 +109,13 @@ namespace ColladaParser
 	/* parse float element */
 	float parseFloat (ticpp::Element* element)
 	{
-		float val;
+		float val = 0;
 		ticpp::Element* child = element->FirstChildElement ();
 		
 		if (child->Value() == "float")
 		{
 			std::istringstream stream (child->GetText());
+			stream.imbue (std::locale::classic ());
 			stream >> val;
 		}
 		
@@ -109,6 +146,10 @@ namespace ColladaParser
 			/* found technique */
 			if (iter->Value() == "technique")
 				technique = iter.Get();
+			
+			/* samplers and surfaces the textures refer to */
+			else if (iter->Value() == "newparam" || iter->Value() == "image")
+				printElement (iter.Get(), mParams);
 		}
 		
 		
@@ -135,6 +176,138 @@ namespace ColladaParser
 			else if (name == "lambert")  parseLambert  (iter.Get());
 			else if (name == "phong")    parsePhong    (iter.Get());
 		}
+		
+		parseTextures (technique);
+		
+		
+		computeHash ();
+	}
+	
+	
+	/* record the texture of every shader property */
+	void ProfileCommon::parseTextures (ticpp::Element* technique)
+	{
+		ticpp::Iterator<ticpp::Element> shader;
+		ticpp::Iterator<ticpp::Element> property;
+		ticpp::Iterator<ticpp::Element> value;
+		
+		for (shader = shader.begin (technique); shader != shader.end(); shader++)
+		{
+			for (property = property.begin (shader.Get()); property != property.end(); property++)
+			{
+				for (value = value.begin (property.Get()); value != value.end(); value++)
+				{
+					if (value->Value() != "texture")
+						continue;
+					
+					mParams += shader->Value() + " " + property->Value() + " " +
+						value->GetAttribute ("texture") + " " + value->GetAttribute ("texcoord") + "\n";
+				}
+			}
+		}
+	}
+	
+	
+	
+	
+	/* write profile */
+	void ProfileCommon::write (CacheWriter& writer) const
+	{
+		writer.writeString (mID);
+		writer.writeString (mTechnique.id);
+		writer.writeString (mTechnique.sid);
+		writer.writeString (mParams);
+		
+		uint8_t shaders = (mTechnique.constant ? 1 : 0) | (mTechnique.lambert ? 2 : 0) |
+		                  (mTechnique.phong    ? 4 : 0) | (mTechnique.blinn   ? 8 : 0);
+		writer.write (shaders);
+		
+		if (mTechnique.constant) writer.write (*mTechnique.constant);
+		if (mTechnique.lambert)  writer.write (*mTechnique.lambert);
+		if (mTechnique.phong)    writer.write (*mTechnique.phong);
+		if (mTechnique.blinn)    writer.write (*mTechnique.blinn);
+		
+		writer.write (mHash);
+	}
+	
+	
+	
+	
+	/* hash colour values */
+	static void hashColour (Hasher& hasher, const Colour& colour)
+	{
+		hasher.add (colour.r);
+		hasher.add (colour.g);
+		hasher.add (colour.b);
+		hasher.add (colour.a);
+	}
+	
+	
+	/* hash common shader values */
+	static void hashShaderCommon (Hasher& hasher, const ProfileCommon::ShaderCommon* shader)
+	{
+		hashColour (hasher, shader->emission);
+		hashColour (hasher, shader->reflective);
+		hashColour (hasher, shader->transparent);
+		
+		hasher.add (shader->reflectivity);
+		hasher.add (shader->transparency);
+		hasher.add (shader->indexOfRefraction);
+	}
+	
+	
+	/* hash lambert and phong values */
+	static void hashLambert (Hasher& hasher, const ProfileCommon::Lambert* shader)
+	{
+		hashShaderCommon (hasher, shader);
+		hashColour (hasher, shader->ambient);
+		hashColour (hasher, shader->diffuse);
+	}
+	
+	static void hashPhong (Hasher& hasher, const ProfileCommon::Phong* shader)
+	{
+		hashLambert (hasher, shader);
+		hashColour (hasher, shader->specular);
+		hasher.add (shader->shininess);
+	}
+	
+	
+	/* hash the technique shaders */
+	void ProfileCommon::computeHash ()
+	{
+		Hasher hasher;
+		
+		/* tag each shader so a missing one changes the hash */
+		if (mTechnique.constant) { hasher.add (1); hashShaderCommon (hasher, mTechnique.constant); }
+		if (mTechnique.lambert)  { hasher.add (2); hashLambert      (hasher, mTechnique.lambert); }
+		if (mTechnique.phong)    { hasher.add (3); hashPhong        (hasher, mTechnique.phong); }
+		if (mTechnique.blinn)    { hasher.add (4); hashPhong        (hasher, mTechnique.blinn); }
+		
+		hasher.add (mParams);
+		mHash = hasher.getHash();
+	}
+	
+	
+	
+	/* compare shader structures, which only hold floats */
+	template <typename T>
+	static bool isEqualShader (const T* a, const T* b)
+	{
+		if (!a || !b)
+			return a == b;
+		
+		return std::memcmp (a, b, sizeof (T)) == 0;
+	}
+	
+	
+	/* compare everything hashed */
+	bool ProfileCommon::isEqual (const ProfileCommon& profile) const
+	{
+		return isEqualShader (mTechnique.constant, profile.mTechnique.constant) &&
+		       isEqualShader (mTechnique.lambert,  profile.mTechnique.lambert) &&
+		       isEqualShader (mTechnique.phong,    profile.mTechnique.phong) &&
+		       isEqualShader (mTechnique.blinn,    profile.mTechnique.blinn) &&
+		       mParams == profile.mParams;
 	}
 	
 	
@@ -0,0 +1,86 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+
+#include "Progress.h"
+
+#include <algorithm>
+
+
+namespace ColladaParser
+{
+
+	thread_local ProgressMonitor* ProgressMonitor::sCurrent = 0;
+	
+	
+	
+	/* constructor */
+	ProgressMonitor::ProgressMonitor (const std::atomic<bool>& cancelled, const ProgressCallback& callback)
+	: mCancelled (cancelled),
+	  mCallback (callback)
+	{
+	}
+	
+	
+	
+	/* set the amount of work */
+	void ProgressMonitor::setTotal (size_t bytes, size_t elements)
+	{
+		std::lock_guard<std::mutex> lock (mMutex);
+		
+		mProgress.totalBytes = bytes;
+		mProgress.totalElements = elements;
+		report ();
+	}
+	
+	
+	/* add finished work */
+	void ProgressMonitor::advance (size_t bytes, size_t elements)
+	{
+		std::lock_guard<std::mutex> lock (mMutex);
+		
+		mProgress.bytes = std::min (mProgress.bytes + bytes, mProgress.totalBytes);
+		mProgress.elements = std::min (mProgress.elements + elements, mProgress.totalElements);
+		report ();
+	}
+	
+	
+	/* everything is done */
+	void ProgressMonitor::finish ()
+	{
+		std::lock_guard<std::mutex> lock (mMutex);
+		
+		mProgress.bytes = mProgress.totalBytes;
+		mProgress.elements = mProgress.totalElements;
+		report ();
+	}
+	
+	
+	/* callbacks are serialised by the lock */
+	void ProgressMonitor::report ()
+	{
+		if (mCallback)
+			mCallback (mProgress);
+	}
+
+}
@@ -22,8 +22,23 @@ THE SOFTWARE.
 
 #include "Reader.h"
 
+#include <cstdlib>
+#include <deque>
+#include <limits>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <stdexcept>
+#include <exception>
+#include <condition_variable>
+#include <sys/stat.h>
 #include <ticpp/ticpp.h>
 
+#include "MappedFile.h"
+#include "Number.h"
+#include "Scanner.h"
+
 
 namespace ColladaParser
 {
@@ -33,6 +48,15 @@ namespace ColladaParser
 	{
 		mFile = file;
 		mHandler = handler;
+		
+		mHandlerThreads = 0;
+		mQueueSize = 16;
+		mOrdered = true;
+		mPipeline = 0;
+		
+		mChunkSize = 0;
+		mCondenseWhiteSpace = true;
+		mStrings = std::make_shared<StringPool> ();
 	}
 	
 	
@@ -45,6 +69,334 @@ namespace ColladaParser
 	
 	
 	
+	/* hand an element over to the handler */
+	static void deliver (ReaderHandler* handler, LibraryType type, void* object)
+	{
+		switch (type)
+		{
+		case LIBRARY_EFFECTS:
+			handler->takeEffect (std::unique_ptr<Effect> (static_cast<Effect*> (object)));
+			break;
+		
+		case LIBRARY_GEOMETRIES:
+			handler->takeGeometry (std::unique_ptr<Geometry> (static_cast<Geometry*> (object)));
+			break;
+		
+		case LIBRARY_VISUAL_SCENES:
+			handler->takeVisualScene (std::unique_ptr<VisualScene> (static_cast<VisualScene*> (object)));
+			break;
+		
+		default:
+			break;
+		}
+	}
+	
+	
+	/* free an element that will never reach the handler */
+	static void discard (LibraryType type, void* object)
+	{
+		switch (type)
+		{
+		case LIBRARY_EFFECTS:       delete static_cast<Effect*> (object);      break;
+		case LIBRARY_GEOMETRIES:    delete static_cast<Geometry*> (object);    break;
+		case LIBRARY_VISUAL_SCENES: delete static_cast<VisualScene*> (object); break;
+		default: break;
+		}
+	}
+	
+	
+	
+	
+	/**
+	 * Bounded queue between the parsing thread and the handler threads.
+	 */
+	class Reader::Pipeline
+	{
+	public:
+		Pipeline (ReaderHandler* handler, MemoryTracker* memory, unsigned int threads, size_t capacity, bool ordered)
+		: mHandler (handler),
+		  mMemory (memory),
+		  mCapacity (capacity > 0 ? capacity : 1),
+		  mOrdered (ordered),
+		  mProduced (0),
+		  mDelivered (0),
+		  mFinished (false),
+		  mFailed (false)
+		{
+			for (unsigned int i = 0; i < threads; i++)
+				mThreads.push_back (std::thread (&Pipeline::work, this));
+		}
+		
+		
+		~Pipeline ()
+		{
+			abort ();
+		}
+		
+		
+		/* queue an element, blocking while the queue is full. rethrows
+		 * a handler failure so the parser stops early */
+		void push (LibraryType type, void* object, const MemoryStats& memory)
+		{
+			std::unique_lock<std::mutex> lock (mMutex);
+			mSpace.wait (lock, [this] { return mQueue.size() < mCapacity || mFailed; });
+			
+			if (mFailed)
+			{
+				discard (type, object);
+				mMemory->release (memory);
+				std::rethrow_exception (mError);
+			}
+			
+			Item item;
+			item.type = type;
+			item.object = object;
+			item.memory = memory;
+			item.sequence = mProduced++;
+			
+			mQueue.push_back (item);
+			mReady.notify_one ();
+		}
+		
+		
+		/* wait for every queued element to be handled */
+		void finish ()
+		{
+			stop ();
+			
+			if (mFailed)
+				std::rethrow_exception (mError);
+		}
+		
+		
+		/* wait until every queued element is handled while keeping the
+		 * handler threads for what follows */
+		void drain ()
+		{
+			std::unique_lock<std::mutex> lock (mMutex);
+			mTurn.wait (lock, [this] { return mDelivered == mProduced || mFailed; });
+			
+			if (mFailed)
+				std::rethrow_exception (mError);
+		}
+		
+		
+		/* stop handling, freeing anything still queued */
+		void abort ()
+		{
+			{
+				std::lock_guard<std::mutex> lock (mMutex);
+				
+				if (!mFailed)
+				{
+					mFailed = true;
+					mError = std::make_exception_ptr (std::runtime_error ("Reader pipeline aborted"));
+				}
+			}
+			
+			stop ();
+		}
+		
+		
+	private:
+		struct Item
+		{
+			LibraryType type;
+			void* object;
+			MemoryStats memory;
+			size_t sequence;
+		};
+		
+		
+		ReaderHandler* mHandler;
+		MemoryTracker* mMemory;
+		size_t mCapacity;
+		bool mOrdered;
+		
+		std::vector<std::thread> mThreads;
+		std::deque<Item> mQueue;
+		
+		std::mutex mMutex;
+		std::condition_variable mReady;
+		std::condition_variable mSpace;
+		std::condition_variable mTurn;
+		
+		size_t mProduced;
+		size_t mDelivered;
+		bool mFinished;
+		bool mFailed;
+		std::exception_ptr mError;
+		
+		
+		/* end of input, join the handler threads */
+		void stop ()
+		{
+			{
+				std::lock_guard<std::mutex> lock (mMutex);
+				mFinished = true;
+			}
+			
+			mReady.notify_all ();
+			mSpace.notify_all ();
+			mTurn.notify_all ();
+			
+			for (size_t i = 0; i < mThreads.size(); i++)
+			{
+				if (mThreads[i].joinable())
+					mThreads[i].join ();
+			}
+			
+			
+			/* anything left after a failure is never handled */
+			while (!mQueue.empty())
+			{
+				discard (mQueue.front().type, mQueue.front().object);
+				mMemory->release (mQueue.front().memory);
+				mQueue.pop_front ();
+			}
+		}
+		
+		
+		/* handler thread */
+		void work ()
+		{
+			std::unique_lock<std::mutex> lock (mMutex);
+			
+			while (true)
+			{
+				mReady.wait (lock, [this] { return !mQueue.empty() || mFinished || mFailed; });
+				
+				if (mFailed || mQueue.empty())
+					return;
+				
+				Item item = mQueue.front ();
+				mQueue.pop_front ();
+				mSpace.notify_one ();
+				
+				
+				/* ordered delivery waits for the previous element */
+				if (mOrdered)
+				{
+					mTurn.wait (lock, [&] { return mDelivered == item.sequence || mFailed; });
+					
+					if (mFailed)
+					{
+						discard (item.type, item.object);
+						mMemory->release (item.memory);
+						return;
+					}
+				}
+				
+				
+				lock.unlock ();
+				
+				try
+				{
+					deliver (mHandler, item.type, item.object);
+					mMemory->release (item.memory);
+				}
+				catch (...)
+				{
+					mMemory->release (item.memory);
+					lock.lock ();
+					
+					if (!mFailed)
+					{
+						mFailed = true;
+						mError = std::current_exception ();
+					}
+					
+					mSpace.notify_all ();
+					mTurn.notify_all ();
+					mReady.notify_all ();
+					return;
+				}
+				
+				lock.lock ();
+				
+				mDelivered++;
+				mTurn.notify_all ();
+			}
+		}
+	};
+	
+	
+	
+	
+	/* hand an element to the handler or the pipeline */
+	void Reader::dispatch (LibraryType type, void* object)
+	{
+		MemoryCounter counter;
+		counter.add (type, object);
+		
+		const MemoryStats& memory = counter.getStats ();
+		
+		/* held until the handler returns */
+		try
+		{
+			mMemory.allocate (memory);
+		}
+		catch (...)
+		{
+			discard (type, object);
+			throw;
+		}
+		
+		for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+		{
+			mRead.categories[i].bytes += memory.categories[i].bytes;
+			mRead.categories[i].count += memory.categories[i].count;
+		}
+		
+		mRead.libraries[type].bytes += memory.libraries[type].bytes;
+		mRead.libraries[type].count += memory.libraries[type].count;
+		mRead.mapped += memory.mapped;
+		
+		
+		if (mPipeline)
+		{
+			mPipeline->push (type, object, memory);
+			return;
+		}
+		
+		try
+		{
+			deliver (mHandler, type, object);
+		}
+		catch (...)
+		{
+			mMemory.release (memory);
+			throw;
+		}
+		
+		mMemory.release (memory);
+	}
+	
+	
+	
+	/* large arrays kept off the heap */
+	void Reader::setOutOfCore (size_t bytes, const std::string& directory)
+	{
+		mMemory.setOutOfCore (bytes, directory);
+	}
+	
+	
+	/* memory read */
+	MemoryStats Reader::getMemoryStats () const
+	{
+		MemoryStats stats = mRead;
+		
+		StringStats strings = mStrings->getStats ();
+		stats.categories[MEMORY_STRINGS].bytes = strings.getBytes ();
+		stats.categories[MEMORY_STRINGS].count = strings.getStrings ();
+		
+		mMemory.getPeaks (stats);
+		return stats;
+	}
+	
+	
+	
+	
 	/* read effect element */
 	void Reader::parseEffects (ticpp::Element* element)
 	{
@@ -57,9 +409,7 @@ namespace ColladaParser
 			/* found effect */
 			if (iter->Value() == "effect")
 			{
-				Effect* effect = new Effect (iter.Get());
-				mHandler->loadEffect (effect);
-				delete effect;
+				dispatch (LIBRARY_EFFECTS, new Effect (iter.Get()));
 			}
 		}
 	}
@@ -79,9 +429,7 @@ namespace ColladaParser
 			/* found geometry */
 			if (iter->Value() == "geometry")
 			{
-				Geometry* geometry = new Geometry (iter.Get());
-				mHandler->loadGeometry (geometry);
-				delete geometry;
+				dispatch (LIBRARY_GEOMETRIES, new Geometry (iter.Get()));
 			}
 		}
 		
@@ -102,12 +450,303 @@ namespace ColladaParser
 			/* found visual scene */
 			if (iter->Value() == "visual_scene")
 			{
-				VisualScene* scene = new VisualScene (iter.Get());
-				mHandler->loadVisualScene (scene);
-				delete scene;
+				dispatch (LIBRARY_VISUAL_SCENES, new VisualScene (iter.Get()));
+			}
+		}
+		
+	}
+	
+	
+	
+	
+	/* parse a fragment of document text */
+	template <typename T>
+	static T* parseFragment (const std::string& text, bool condense)
+	{
+		MemoryTracker::Hold dom (MemoryTracker::getCurrent(), MEMORY_DOM, MemoryTracker::estimateDOM (text.size()));
+		
+		ticpp::Document doc;
+		doc.SetCondenseWhiteSpace (condense);
+		doc.Parse (text);
+		
+		return new T (doc.FirstChildElement());
+	}
+	
+	
+	
+	/* inputs of a primitive or vertices element */
+	static void readInputs (const Scanner& scanner, const std::vector<Scanner::Element>& children, std::vector<StreamInput>& inputs)
+	{
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			if (children[i].name != "input")
+				continue;
+			
+			StreamInput input;
+			input.semantic = scanner.getAttribute (children[i], "semantic");
+			input.source   = scanner.getAttribute (children[i], "source");
+			input.offset   = std::atoi (scanner.getAttribute (children[i], "offset").c_str());
+			
+			inputs.push_back (input);
+		}
+	}
+	
+	
+	
+	/* stream a geometry in chunks */
+	void Reader::streamGeometry (const Scanner& scanner, const Scanner::Element& element)
+	{
+		/* the chunks go straight to the handler, so nothing may still be
+		 * with a handler thread */
+		if (mPipeline)
+			mPipeline->drain ();
+		
+		mHandler->beginGeometry (element.id, scanner.getAttribute (element, "name"));
+		
+		std::vector<Scanner::Element> children;
+		scanner.getChildren (element, children);
+		
+		
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			if (children[i].name != "mesh")
+				continue;
+			
+			std::vector<Scanner::Element> elements;
+			scanner.getChildren (children[i], elements);
+			
+			
+			/* sift through mesh elements
+			 * source[1-*], vertices[1], primitives[*], extra[*] */
+			for (size_t e = 0; e < elements.size(); e++)
+			{
+				const std::string& name = elements[e].name;
+				
+				if (name == "source")
+					streamSource (scanner, elements[e]);
+				
+				else if (name == "vertices")
+				{
+					std::vector<Scanner::Element> inputs;
+					scanner.getChildren (elements[e], inputs);
+					
+					std::vector<StreamInput> list;
+					readInputs (scanner, inputs, list);
+					
+					mHandler->onVertices (elements[e].id, list);
+				}
+				
+				else if (name == "triangles" || name == "lines" || name == "polylist" ||
+				         name == "polygons"  || name == "linestrips" ||
+				         name == "trifans"   || name == "tristrips")
+					streamPrimitive (scanner, elements[e]);
+			}
+		}
+		
+		mHandler->endGeometry ();
+	}
+	
+	
+	
+	/* stream the float array of a source */
+	void Reader::streamSource (const Scanner& scanner, const Scanner::Element& element)
+	{
+		std::vector<Scanner::Element> children;
+		scanner.getChildren (element, children);
+		
+		const Scanner::Element* array = 0;
+		unsigned int stride = 1;
+		
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			if (children[i].name == "float_array")
+				array = &children[i];
+			
+			/* the accessor follows the array, read it first */
+			else if (children[i].name == "technique_common")
+			{
+				std::vector<Scanner::Element> accessor;
+				scanner.getChildren (children[i], accessor);
+				
+				if (!accessor.empty())
+				{
+					std::string value = scanner.getAttribute (accessor[0], "stride");
+					if (!value.empty()) stride = std::atoi (value.c_str());
+				}
+			}
+		}
+		
+		if (!array)
+			return;
+		
+		
+		std::string attribute = scanner.getAttribute (*array, "count");
+		unsigned int count = std::atoi (attribute.c_str());
+		mHandler->beginSource (element.id, count, stride);
+		
+		/* without a count every value up to the end tag is streamed */
+		size_t limit = attribute.empty() ? std::numeric_limits<size_t>::max() : count;
+		
+		
+		/* decode a chunk at a time, the text always ends at the '<' of
+		 * the end tag so the conversion can't run past it */
+		std::vector<float> chunk;
+		chunk.reserve (mChunkSize);
+		
+		const char* text = scanner.getData() + array->content;
+		const char* end  = scanner.getData() + array->contentEnd;
+		size_t offset = 0;
+		
+		while (text < end && offset + chunk.size() < limit)
+		{
+			float value;
+			const char* next = readNumber (text, end, value);
+			
+			if (next == text)
+				break;
+			
+			chunk.push_back (value);
+			text = next;
+			
+			if (chunk.size() == mChunkSize)
+			{
+				mHandler->onSourceChunk (element.id, offset, &chunk[0], chunk.size());
+				offset += chunk.size();
+				chunk.clear ();
+			}
+		}
+		
+		if (!chunk.empty())
+			mHandler->onSourceChunk (element.id, offset, &chunk[0], chunk.size());
+	}
+	
+	
+	
+	/* stream the indices of a primitive */
+	void Reader::streamPrimitive (const Scanner& scanner, const Scanner::Element& element)
+	{
+		std::vector<Scanner::Element> children;
+		scanner.getChildren (element, children);
+		
+		
+		StreamPrimitive primitive;
+		primitive.type     = element.name;
+		primitive.material = scanner.getAttribute (element, "material");
+		primitive.count    = std::atoi (scanner.getAttribute (element, "count").c_str());
+		primitive.stride   = 1;
+		
+		readInputs (scanner, children, primitive.inputs);
+		
+		for (size_t i = 0; i < primitive.inputs.size(); i++)
+			primitive.stride = std::max (primitive.stride, primitive.inputs[i].offset + 1);
+		
+		mHandler->beginPrimitive (primitive);
+		
+		
+		std::vector<uint32_t> chunk;
+		chunk.reserve (mChunkSize);
+		size_t offset = 0;
+		
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			if (children[i].name != "p")
+				continue;
+			
+			const char* text = scanner.getData() + children[i].content;
+			const char* end  = scanner.getData() + children[i].contentEnd;
+			
+			while (text < end)
+			{
+				unsigned long value;
+				const char* next = readNumber (text, end, value);
+				
+				if (next == text)
+					break;
+				
+				chunk.push_back (uint32_t (value));
+				text = next;
+				
+				if (chunk.size() == mChunkSize)
+				{
+					mHandler->onIndexChunk (offset, &chunk[0], chunk.size());
+					offset += chunk.size();
+					chunk.clear ();
+				}
 			}
 		}
 		
+		if (!chunk.empty())
+			mHandler->onIndexChunk (offset, &chunk[0], chunk.size());
+		
+		mHandler->endPrimitive ();
+	}
+	
+	
+	
+	
+	/* read the document through the tag scanner, parsing only the
+	 * accepted elements */
+	bool Reader::parseScanned ()
+	{
+		MappedFile file (mFile);
+		Scanner scanner (file.getData(), file.getSize());
+		
+		std::vector<Scanner::Element> libraries;
+		scanner.getChildren (scanner.getRoot(), libraries);
+		
+		
+		/* sift through all collada elements */
+		for (size_t i = 0; i < libraries.size(); i++)
+		{
+			const std::string& name = libraries[i].name;
+			
+			std::vector<Scanner::Element> elements;
+			scanner.getChildren (libraries[i], elements);
+			
+			
+			for (size_t e = 0; e < elements.size(); e++)
+			{
+				const Scanner::Element& element = elements[e];
+				
+				/* found effect */
+				if (name == "library_effects" && element.name == "effect")
+				{
+					if (!mFilter.accepts (LIBRARY_EFFECTS, element.id))
+						continue;
+					
+					dispatch (LIBRARY_EFFECTS, parseFragment<Effect> (scanner.getSource (element), mCondenseWhiteSpace));
+				}
+				
+				/* found geometry */
+				else if (name == "library_geometries" && element.name == "geometry")
+				{
+					if (!mFilter.accepts (LIBRARY_GEOMETRIES, element.id))
+						continue;
+					
+					if (mChunkSize > 0)
+					{
+						streamGeometry (scanner, element);
+						continue;
+					}
+					
+					dispatch (LIBRARY_GEOMETRIES, parseFragment<Geometry> (scanner.getSource (element), mCondenseWhiteSpace));
+				}
+				
+				/* found visual scene */
+				else if (name == "library_visual_scenes" && element.name == "visual_scene")
+				{
+					if (!mFilter.accepts (LIBRARY_VISUAL_SCENES, element.id))
+						continue;
+					
+					std::string text = mFilter.filterScene (scanner, element);
+					if (text.empty()) continue;
+					
+					dispatch (LIBRARY_VISUAL_SCENES, parseFragment<VisualScene> (text, mCondenseWhiteSpace));
+				}
+			}
+		}
+		
+		return true;
 	}
 	
 	
@@ -116,7 +755,53 @@ namespace ColladaParser
 	/* open reader stream */
 	bool Reader::open ()
 	{
+		mRead = MemoryStats ();
+		mMemory.reset ();
+		
+		if (mHandlerThreads == 0)
+			return parse ();
+		
+		
+		/* parse on this thread while the handler threads consume */
+		Pipeline pipeline (mHandler, &mMemory, mHandlerThreads, mQueueSize, mOrdered);
+		mPipeline = &pipeline;
+		
+		try
+		{
+			parse ();
+		}
+		catch (...)
+		{
+			mPipeline = 0;
+			pipeline.abort ();
+			throw;
+		}
+		
+		mPipeline = 0;
+		pipeline.finish ();
+		
+		return true;
+	}
+	
+	
+	
+	/* parse the whole document */
+	bool Reader::parse ()
+	{
+		StringPool::Scope scope (mStrings);
+		MemoryTracker::Scope memory (&mMemory);
+		
+		if (!mFilter.isEmpty() || mChunkSize > 0)
+			return parseScanned ();
+		
+		
+		struct stat info;
+		size_t size = stat (mFile.c_str(), &info) == 0 ? info.st_size : 0;
+		
+		MemoryTracker::Hold dom (&mMemory, MEMORY_DOM, MemoryTracker::estimateDOM (size));
+		
 		ticpp::Document doc (mFile);
+		doc.SetCondenseWhiteSpace (mCondenseWhiteSpace);
 		doc.LoadFile ();
 		
 		
@@ -149,40 +834,226 @@ namespace ColladaParser
 	
 	
 	
-	/* does a quick parse to get basic document information */
+	/* count the indices of a primitive which has no fixed vertex count.
+	 * polylists list the vertices of each polygon in the vcount, the
+	 * others hold one index per input offset for each vertex in their p */
+	static unsigned int countIndices (const Scanner& scanner, const Scanner::Element& element)
+	{
+		std::vector<Scanner::Element> children;
+		scanner.getChildren (element, children);
+		
+		unsigned int stride = 1;
+		unsigned int values = 0;
+		unsigned int vertices = 0;
+		
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			const char* text = scanner.getData() + children[i].content;
+			const char* end  = scanner.getData() + children[i].contentEnd;
+			
+			if (children[i].name == "input")
+			{
+				unsigned int offset = std::atoi (scanner.getAttribute (children[i], "offset").c_str());
+				stride = std::max (stride, offset + 1);
+			}
+			
+			else if (children[i].name == "vcount")
+			{
+				unsigned int count;
+				const char* next;
+				
+				while ((next = readNumber (text, end, count)) != text)
+				{
+					vertices += count;
+					text = next;
+				}
+			}
+			
+			/* only the values are counted, they aren't converted */
+			else if (children[i].name == "p")
+			{
+				bool space = true;
+				
+				for (; text < end; text++)
+				{
+					bool blank = *text == ' ' || *text == '\t' || *text == '\n' || *text == '\r';
+					values += space && !blank;
+					space = blank;
+				}
+			}
+		}
+		
+		return element.name == "polylist" ? vertices : values / stride;
+	}
+	
+	
+	
+	/* read geometry counts from the mesh attributes */
+	static void readGeometryInfo (const Scanner& scanner, const Scanner::Element& element, DocumentInfo::GeometryInfo& info)
+	{
+		std::vector<Scanner::Element> children;
+		scanner.getChildren (element, children);
+		
+		const Scanner::Element* mesh = 0;
+		
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			if (children[i].name == "mesh")
+				mesh = &children[i];
+		}
+		
+		if (!mesh)
+			return;
+		
+		
+		std::vector<Scanner::Element> elements;
+		scanner.getChildren (*mesh, elements);
+		
+		std::string positions;
+		
+		
+		/* sift through mesh elements
+		 * source[1-*], vertices[1], primitives[*], extra[*] */
+		for (size_t i = 0; i < elements.size(); i++)
+		{
+			const Scanner::Element& el = elements[i];
+			
+			/* vertices names the position source */
+			if (el.name == "vertices")
+			{
+				std::vector<Scanner::Element> inputs;
+				scanner.getChildren (el, inputs);
+				
+				for (size_t n = 0; n < inputs.size(); n++)
+				{
+					if (scanner.getAttribute (inputs[n], "semantic") == "POSITION")
+						positions = scanner.getAttribute (inputs[n], "source");
+				}
+			}
+			
+			
+			/* primitives */
+			else if (el.name == "triangles" || el.name == "lines" || el.name == "polylist" ||
+			         el.name == "polygons"  || el.name == "linestrips" ||
+			         el.name == "trifans"   || el.name == "tristrips")
+			{
+				unsigned int count = std::atoi (scanner.getAttribute (el, "count").c_str());
+				info.primitiveCount += count;
+				
+				if      (el.name == "triangles") info.indexCount += count * 3;
+				else if (el.name == "lines")     info.indexCount += count * 2;
+				else                             info.indexCount += countIndices (scanner, el);
+			}
+		}
+		
+		
+		/* position accessor count */
+		for (size_t i = 0; i < elements.size(); i++)
+		{
+			if (elements[i].name != "source" || "#" + elements[i].id != positions)
+				continue;
+			
+			std::vector<Scanner::Element> source;
+			scanner.getChildren (elements[i], source);
+			
+			for (size_t n = 0; n < source.size(); n++)
+			{
+				if (source[n].name != "technique_common")
+					continue;
+				
+				std::vector<Scanner::Element> accessor;
+				scanner.getChildren (source[n], accessor);
+				
+				if (!accessor.empty())
+					info.vertexCount = std::atoi (scanner.getAttribute (accessor[0], "count").c_str());
+			}
+		}
+	}
+	
+	
+	
+	/* read asset unit and up axis */
+	static void readAssetInfo (const Scanner& scanner, const Scanner::Element& element, DocumentInfo& info)
+	{
+		std::vector<Scanner::Element> children;
+		scanner.getChildren (element, children);
+		
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			if (children[i].name == "unit")
+			{
+				std::string meter = scanner.getAttribute (children[i], "meter");
+				std::string name  = scanner.getAttribute (children[i], "name");
+				
+				if (!meter.empty()) readNumber (meter.data(), meter.data() + meter.size(), info.unitMeter);
+				if (!name.empty())  info.unitName  = name;
+			}
+			
+			else if (children[i].name == "up_axis")
+			{
+				std::istringstream stream (scanner.getText (children[i]));
+				stream >> info.upAxis;
+			}
+		}
+	}
+	
+	
+	
+	
+	/* does a quick parse to get basic document information. the file
+	 * is only scanned for tags, text content is skipped over */
 	DocumentInfo Reader::getInfo ()
 	{
 		DocumentInfo info;
 		
 		
-		ticpp::Document doc (mFile);
-		doc.LoadFile ();
-		
+		MappedFile file (mFile);
+		Scanner scanner (file.getData(), file.getSize());
 		
-		ticpp::Iterator<ticpp::Element> iter;
+		std::vector<Scanner::Element> libraries;
+		scanner.getChildren (scanner.getRoot(), libraries);
 		
 		
 		/* sift through all collada elements */
-		for (iter = iter.begin(doc.FirstChildElement()); iter != iter.end(); iter++)
+		for (size_t i = 0; i < libraries.size(); i++)
 		{
-			std::string name = iter->Value();
+			const std::string& name = libraries[i].name;
 			
-			/* found geometry library */
-			if (name == "library_geometries")
+			if (name == "asset")
+			{
+				readAssetInfo (scanner, libraries[i], info);
+				continue;
+			}
+			
+			
+			std::vector<Scanner::Element> elements;
+			scanner.getChildren (libraries[i], elements);
+			
+			for (size_t e = 0; e < elements.size(); e++)
 			{
-				ticpp::Iterator<ticpp::Element> it;
+				const Scanner::Element& element = elements[e];
 				
-				/* loop through all geometries */
-				for (it = it.begin (iter.Get()); it != it.end(); it++)
+				/* found geometry */
+				if (name == "library_geometries" && element.name == "geometry")
 				{
 					DocumentInfo::GeometryInfo geom;
-					geom.id = it->GetAttribute ("id");
-					geom.name = it->GetAttributeOrDefault ("name", "");
+					geom.id = element.id;
+					geom.name = scanner.getAttribute (element, "name");
 					
+					readGeometryInfo (scanner, element, geom);
 					info.geometries.push_back (geom);
-				} /* end geometries */
+				}
+				
+				else if (name == "library_materials" && element.name == "material")
+					info.materialCount++;
+				
+				else if (name == "library_effects" && element.name == "effect")
+					info.effectCount++;
+				
+				else if (name == "library_visual_scenes" && element.name == "visual_scene")
+					info.nodeCount += scanner.countElements (element, "node");
+				
 			}
-			
 		} /* end document */
 		
 		
@@ -0,0 +1,458 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "Scanner.h"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "Progress.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define COLLADA_PARSER_USE_SSE2
+	
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
+
+namespace ColladaParser
+{
+
+	/* constructor */
+	Scanner::Scanner (const char* data, size_t size)
+	: mData (data),
+	  mSize (size)
+	{
+	}
+	
+	
+	
+	
+	/* report malformed text */
+	void Scanner::fail (const std::string& message, size_t pos) const
+	{
+		std::ostringstream error;
+		error << "Parsing failed: " << message << " at offset " << pos;
+		throw std::runtime_error (error.str());
+	}
+	
+	
+	
+	/* offset past the next occurrence of a token */
+	size_t Scanner::find (size_t pos, const char* token) const
+	{
+		size_t length = std::strlen (token);
+		
+		while (pos < mSize)
+		{
+			const void* found = memchr (mData + pos, token[0], mSize - pos);
+			if (!found) break;
+			
+			pos = static_cast<const char*> (found) - mData;
+			
+			if (pos + length <= mSize && std::memcmp (mData + pos, token, length) == 0)
+				return pos + length;
+			
+			pos++;
+		}
+		
+		fail (std::string ("Expected '") + token + "'", mSize);
+		return mSize;
+	}
+	
+	
+	
+	/* skip markup which isn't an element, returning the offset past it
+	 * or the same offset when an element or end tag starts there */
+	size_t Scanner::skipMarkup (size_t pos) const
+	{
+		const char* text = mData + pos;
+		size_t remaining = mSize - pos;
+		
+		if (remaining >= 4 && std::memcmp (text, "<!--", 4) == 0)
+			return find (pos + 4, "-->");
+		
+		if (remaining >= 9 && std::memcmp (text, "<![CDATA[", 9) == 0)
+			return find (pos + 9, "]]>");
+		
+		if (remaining >= 2 && std::memcmp (text, "<?", 2) == 0)
+			return find (pos + 2, "?>");
+		
+		if (remaining >= 2 && std::memcmp (text, "<!", 2) == 0)
+			return find (pos + 2, ">");
+		
+		return pos;
+	}
+	
+	
+	
+#ifdef COLLADA_PARSER_USE_SSE2
+	/* index of the lowest set bit */
+	static inline int lowestBit (int mask)
+	{
+	#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward (&index, mask);
+		return index;
+	#else
+		return __builtin_ctz (mask);
+	#endif
+	}
+#endif
+	
+	
+	/* find the first '>' or quote, sixteen bytes at a time with SSE2 */
+	static const char* findTagDelimiter (const char* begin, const char* end)
+	{
+#ifdef COLLADA_PARSER_USE_SSE2
+		const __m128i close  = _mm_set1_epi8 ('>');
+		const __m128i double_quote = _mm_set1_epi8 ('"');
+		const __m128i single_quote = _mm_set1_epi8 ('\'');
+		
+		for (; begin + 16 <= end; begin += 16)
+		{
+			__m128i block = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (begin));
+			
+			__m128i match = _mm_or_si128 (_mm_cmpeq_epi8 (block, close),
+			                _mm_or_si128 (_mm_cmpeq_epi8 (block, double_quote),
+			                              _mm_cmpeq_epi8 (block, single_quote)));
+			
+			int mask = _mm_movemask_epi8 (match);
+			
+			if (mask)
+				return begin + lowestBit (mask);
+		}
+#endif
+		
+		for (; begin < end; begin++)
+		{
+			if (*begin == '>' || *begin == '"' || *begin == '\'')
+				return begin;
+		}
+		
+		return end;
+	}
+	
+	
+	
+	/* offset past the end of a start tag, skipping quoted values */
+	size_t Scanner::skipStartTag (size_t pos, bool& empty) const
+	{
+		size_t begin = pos;
+		
+		while (pos < mSize)
+		{
+			pos = findTagDelimiter (mData + pos, mData + mSize) - mData;
+			if (pos >= mSize) break;
+			
+			char c = mData[pos];
+			
+			if (c == '"' || c == '\'')
+			{
+				const void* quote = memchr (mData + pos + 1, c, mSize - pos - 1);
+				if (!quote) fail ("Unterminated attribute value", pos);
+				
+				pos = static_cast<const char*> (quote) - mData + 1;
+				continue;
+			}
+			
+			if (c == '>')
+			{
+				empty = mData[pos - 1] == '/';
+				return pos + 1;
+			}
+		}
+		
+		fail ("Unterminated start tag", begin);
+		return mSize;
+	}
+	
+	
+	
+	/* read the start tag at the offset and find the end of the element */
+	size_t Scanner::parseElement (size_t pos, Element& element) const
+	{
+		element.begin = pos;
+		
+		
+		/* element name */
+		size_t name = pos + 1;
+		size_t end = name;
+		
+		while (end < mSize && !strchr (" \t\r\n/>", mData[end]))
+			end++;
+		
+		element.name.assign (mData + name, end - name);
+		
+		
+		/* walk the attributes to the end of the start tag */
+		bool empty;
+		end = skipStartTag (end, empty);
+		
+		element.content = end;
+		element.id = getAttribute (element, "id");
+		
+		
+		if (empty)
+		{
+			element.contentEnd = end;
+			element.end = end;
+		}
+		else
+		{
+			element.contentEnd = findEndTag (end);
+			element.end = find (element.contentEnd, ">");
+		}
+		
+		return element.end;
+	}
+	
+	
+	
+	/* find the end tag matching an element whose content starts at
+	 * the offset, returning the offset of its '<' */
+	size_t Scanner::findEndTag (size_t pos) const
+	{
+		int depth = 0;
+		unsigned int tags = 0;
+		
+		while (true)
+		{
+			const void* found = pos < mSize ? memchr (mData + pos, '<', mSize - pos) : 0;
+			if (!found) fail ("Missing end tag", pos);
+			
+			pos = static_cast<const char*> (found) - mData;
+			
+			
+			size_t next = skipMarkup (pos);
+			
+			if (next != pos)
+			{
+				pos = next;
+				continue;
+			}
+			
+			
+			/* end tag */
+			if (pos + 1 < mSize && mData[pos + 1] == '/')
+			{
+				if (depth == 0)
+					return pos;
+				
+				depth--;
+				pos = find (pos, ">");
+				continue;
+			}
+			
+			
+			/* nested start tag */
+			if ((++tags & 4095) == 0)
+				ProgressMonitor::check ();
+			
+			bool empty;
+			pos = skipStartTag (pos + 1, empty);
+			
+			if (!empty)
+				depth++;
+		}
+	}
+	
+	
+	
+	
+	/* find the document root */
+	Scanner::Element Scanner::getRoot () const
+	{
+		Element root;
+		size_t pos = 0;
+		
+		while (true)
+		{
+			const void* found = pos < mSize ? memchr (mData + pos, '<', mSize - pos) : 0;
+			if (!found) fail ("No root element", pos);
+			
+			pos = static_cast<const char*> (found) - mData;
+			
+			size_t next = skipMarkup (pos);
+			
+			if (next == pos)
+				break;
+			
+			pos = next;
+		}
+		
+		parseElement (pos, root);
+		return root;
+	}
+	
+	
+	
+	/* list child elements */
+	void Scanner::getChildren (const Element& parent, std::vector<Element>& children) const
+	{
+		size_t pos = parent.content;
+		
+		while (pos < parent.contentEnd)
+		{
+			const void* found = memchr (mData + pos, '<', parent.contentEnd - pos);
+			if (!found) break;
+			
+			pos = static_cast<const char*> (found) - mData;
+			
+			size_t next = skipMarkup (pos);
+			
+			if (next != pos)
+			{
+				pos = next;
+				continue;
+			}
+			
+			ProgressMonitor::check ();
+			
+			Element child;
+			pos = parseElement (pos, child);
+			children.push_back (child);
+		}
+	}
+	
+	
+	
+	
+	/* count nested elements of a name */
+	size_t Scanner::countElements (const Element& parent, const std::string& name) const
+	{
+		size_t count = 0;
+		size_t pos = parent.content;
+		unsigned int tags = 0;
+		
+		while (pos < parent.contentEnd)
+		{
+			const void* found = memchr (mData + pos, '<', parent.contentEnd - pos);
+			if (!found) break;
+			
+			pos = static_cast<const char*> (found) - mData;
+			
+			size_t next = skipMarkup (pos);
+			
+			if (next != pos)
+			{
+				pos = next;
+				continue;
+			}
+			
+			
+			/* end tag */
+			if (pos + 1 < mSize && mData[pos + 1] == '/')
+			{
+				pos = find (pos, ">");
+				continue;
+			}
+			
+			
+			/* start tag, matched on the whole name */
+			if ((++tags & 4095) == 0)
+				ProgressMonitor::check ();
+			
+			size_t end = pos + 1 + name.size();
+			
+			if (end < mSize && std::memcmp (mData + pos + 1, name.data(), name.size()) == 0 &&
+			    mData[end] && strchr (" \t\r\n/>", mData[end]))
+				count++;
+			
+			bool empty;
+			pos = skipStartTag (pos + 1, empty);
+		}
+		
+		return count;
+	}
+	
+	
+	
+	
+	/* read an attribute from the start tag */
+	std::string Scanner::getAttribute (const Element& element, const std::string& name) const
+	{
+		size_t pos = element.begin + 1 + element.name.size();
+		size_t end = element.content;
+		
+		while (pos < end)
+		{
+			/* skip white space */
+			while (pos < end && strchr (" \t\r\n", mData[pos]))
+				pos++;
+			
+			/* attribute name */
+			size_t begin = pos;
+			
+			while (pos < end && !strchr (" \t\r\n=/>", mData[pos]))
+				pos++;
+			
+			if (pos == begin)
+				break;
+			
+			size_t length = pos - begin;
+			
+			
+			/* attribute value */
+			while (pos < end && mData[pos] != '"' && mData[pos] != '\'')
+				pos++;
+			
+			if (pos >= end)
+				break;
+			
+			char quote = mData[pos];
+			size_t value = pos + 1;
+			
+			const void* close = memchr (mData + value, quote, end - value);
+			if (!close) break;
+			
+			pos = static_cast<const char*> (close) - mData + 1;
+			
+			
+			if (length == name.size() && std::memcmp (mData + begin, name.data(), length) == 0)
+				return std::string (mData + value, pos - 1 - value);
+		}
+		
+		return std::string ();
+	}
+	
+	
+	
+	/* element content text */
+	std::string Scanner::getText (const Element& element) const
+	{
+		return std::string (mData + element.content, element.contentEnd - element.content);
+	}
+	
+	
+	/* whole element text */
+	std::string Scanner::getSource (const Element& element) const
+	{
+		return std::string (mData + element.begin, element.end - element.begin);
+	}
+
+}
@@ -22,19 +22,66 @@ THE SOFTWARE.
 
 #include "Source.h"
 
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
 #include <ticpp/ticpp.h>
 
+#include "Cache.h"
+#include "Progress.h"
+#include "Memory.h"
+#include "MappedFile.h"
+#include "Number.h"
+
 
 namespace ColladaParser
 {
 
+	static void decodeArray (std::string& text, unsigned int count, float* values);
+	
+	
 	/* constructor */
 	Source::Source (ticpp::Element *element)
+	: mData (new Array ())
 	{
 		parse (element);
 	}
 	
 	
+	/* constructor */
+	Source::Source (CacheReader& reader)
+	: mData (new Array ())
+	{
+		StringPool* strings = StringPool::getCurrent ();
+		
+		mID   = strings->intern (reader.readString (), STRING_ID);
+		mName = strings->intern (reader.readString (), STRING_NAME);
+		
+		mAccessor.count  = reader.read<uint32_t> ();
+		mAccessor.offset = reader.read<uint32_t> ();
+		mAccessor.stride = reader.read<uint32_t> ();
+		
+		mAccessor.params.resize (reader.read<uint32_t> ());
+		
+		for (size_t i = 0; i < mAccessor.params.size(); i++)
+		{
+			mAccessor.params[i].skip = reader.read<uint8_t> () != 0;
+			mAccessor.params[i].type = DataType (reader.read<uint32_t> ());
+		}
+		
+		mHash = reader.read<Hash> ();
+		
+		
+		/* use the array in place */
+		size_t size;
+		mData->data = static_cast<const float*> (reader.readArray (size));
+		mData->count = size / sizeof (float);
+		mData->mapping = reader.getFile ();
+		mData->decoded.store (true, std::memory_order_release);
+	}
+	
+	
 	/* destructor */
 	Source::~Source ()
 	{
@@ -50,8 +97,10 @@ namespace ColladaParser
 		
 		
 		/* get source properties */
-		mID   = element->GetAttribute ("id");
-		mName = element->GetAttributeOrDefault ("name", "");
+		StringPool* strings = StringPool::getCurrent ();
+		
+		mID   = strings->intern (element->GetAttribute ("id"), STRING_ID);
+		mName = strings->intern (element->GetAttributeOrDefault ("name", ""), STRING_NAME);
 		
 		
 		/* sift through source elements */
@@ -64,26 +113,18 @@ namespace ColladaParser
 			/* found float array */
 			if (el == "float_array")
 			{
-				/* get float data */
-				unsigned int count;
-				iter->GetAttribute ("count", &count);
-				
-				mData.reserve (count);
+				/* keep the text, it is decoded on first access */
+				iter->GetAttribute ("count", &mData->count);
+				mData->text = iter->GetText (false);
 				
+				/* every value takes at least a digit and a separator, a
+				 * larger count would only pad the array with zeros */
+				size_t limit = mData->text.size() / 2 + 1;
 				
-				/* float data */
-				std::string data = iter->GetText ();
-				std::istringstream stream (data);
+				if (mData->count > limit)
+					mData->count = limit;
 				
-				/* convert and add to source */
-				while (count > 0)
-				{
-					float val;
-					stream >> val;
-					mData.push_back (val);
-					
-					count--;
-				}
+				MemoryTracker::check (MEMORY_SOURCES, size_t (mData->count) * sizeof (float));
 			}
 			
 			
@@ -95,6 +136,23 @@ namespace ColladaParser
 			}
 			
 		} /* end source */
+		
+		
+		computeHash ();
+		
+		
+		/* large arrays are decoded now rather than keeping their text */
+		std::shared_ptr<MappedBuffer> buffer = MemoryTracker::createBuffer (size_t (mData->count) * sizeof (float));
+		
+		if (buffer)
+		{
+			float* values = static_cast<float*> (buffer->getData());
+			decodeArray (mData->text, mData->count, values);
+			
+			mData->buffer = buffer;
+			mData->data = values;
+			mData->decoded.store (true, std::memory_order_release);
+		}
 	}
 	
 	
@@ -125,6 +183,145 @@ namespace ColladaParser
 	
 	
 	
+	/* decode array text into the given values, then release the text */
+	static void decodeArray (std::string& text, unsigned int count, float* values)
+	{
+		const char* begin = text.data ();
+		const char* end = begin + text.size ();
+		
+		unsigned int i = 0;
+		
+		for (; i < count; i++)
+		{
+			if ((i & 4095) == 0)
+				ProgressMonitor::check ();
+			
+			float value;
+			const char* next = readNumber (begin, end, value);
+			
+			/* pad a short array rather than read past it */
+			if (next == begin)
+				break;
+			
+			values[i] = value;
+			begin = next;
+		}
+		
+		std::fill (values + i, values + count, 0.0f);
+		
+		
+		/* release the text */
+		std::string().swap (text);
+	}
+	
+	
+	/* decode the array text once */
+	void Source::decode () const
+	{
+		Array& data = *mData;
+		
+		if (data.decoded.load (std::memory_order_acquire))
+			return;
+		
+		std::call_once (data.once, [&data] ()
+		{
+			data.values.resize (data.count);
+			float* values = data.values.empty() ? 0 : &data.values[0];
+			
+			decodeArray (data.text, data.count, values);
+			data.data = values;
+		});
+		
+		data.decoded.store (true, std::memory_order_release);
+	}
+	
+	
+	
+	/* write the source with its decoded data */
+	void Source::write (CacheWriter& writer) const
+	{
+		decode ();
+		
+		writer.writeString (mID);
+		writer.writeString (mName);
+		
+		writer.write (uint32_t (mAccessor.count));
+		writer.write (uint32_t (mAccessor.offset));
+		writer.write (uint32_t (mAccessor.stride));
+		writer.write (uint32_t (mAccessor.params.size()));
+		
+		for (size_t i = 0; i < mAccessor.params.size(); i++)
+		{
+			writer.write (uint8_t (mAccessor.params[i].skip));
+			writer.write (uint32_t (mAccessor.params[i].type));
+		}
+		
+		writer.write (mHash);
+		writer.writeArray (mData->data, mData->count * sizeof (float));
+	}
+	
+	
+	
+	
+	/* hash the data text and accessor layout */
+	void Source::computeHash ()
+	{
+		Hasher hasher;
+		
+		hasher.add (mData->text);
+		hasher.add (mData->count);
+		
+		hasher.add (mAccessor.count);
+		hasher.add (mAccessor.offset);
+		hasher.add (mAccessor.stride);
+		
+		for (size_t i = 0; i < mAccessor.params.size(); i++)
+		{
+			hasher.add (int (mAccessor.params[i].skip));
+			hasher.add (int (mAccessor.params[i].type));
+		}
+		
+		mHash = hasher.getHash();
+	}
+	
+	
+	/* compare the data and accessor layout */
+	bool Source::isEqual (DataSource* other)
+	{
+		Source* source = dynamic_cast<Source*> (other);
+		
+		if (!source || mAccessor.count != source->mAccessor.count ||
+		    mAccessor.offset != source->mAccessor.offset ||
+		    mAccessor.stride != source->mAccessor.stride ||
+		    mAccessor.params.size() != source->mAccessor.params.size())
+			return false;
+		
+		for (size_t i = 0; i < mAccessor.params.size(); i++)
+		{
+			if (mAccessor.params[i].skip != source->mAccessor.params[i].skip ||
+			    mAccessor.params[i].type != source->mAccessor.params[i].type)
+				return false;
+		}
+		
+		if (mData == source->mData)
+			return true;
+		
+		if (mData->count != source->mData->count)
+			return false;
+		
+		
+		/* compare the text when neither is decoded yet */
+		if (!isDecoded() && !source->isDecoded())
+			return mData->text == source->mData->text;
+		
+		decode ();
+		source->decode ();
+		
+		return mData->count == 0 || std::memcmp (mData->data, source->mData->data, getDataSize()) == 0;
+	}
+	
+	
+	
 	/* data type conversion */
 	DataType Source::parseType (std::string type)
 	{
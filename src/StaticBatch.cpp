@@ -0,0 +1,197 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "StaticBatch.h"
+
+#include <cmath>
+#include <unordered_map>
+
+#include "ThreadPool.h"
+#include "TransformEvaluator.h"
+
+
+namespace ColladaParser
+{
+
+	/* the adjugate of the upper 3x3 transforms normals like the inverse
+	 * transpose does, up to a scale that normalising removes */
+	static Matrix normalMatrix (const Matrix& m)
+	{
+		Matrix n = Matrix::identity ();
+		
+		n(0,0) = m(1,1) * m(2,2) - m(1,2) * m(2,1);
+		n(0,1) = m(1,2) * m(2,0) - m(1,0) * m(2,2);
+		n(0,2) = m(1,0) * m(2,1) - m(1,1) * m(2,0);
+		
+		n(1,0) = m(0,2) * m(2,1) - m(0,1) * m(2,2);
+		n(1,1) = m(0,0) * m(2,2) - m(0,2) * m(2,0);
+		n(1,2) = m(0,1) * m(2,0) - m(0,0) * m(2,1);
+		
+		n(2,0) = m(0,1) * m(1,2) - m(0,2) * m(1,1);
+		n(2,1) = m(0,2) * m(1,0) - m(0,0) * m(1,2);
+		n(2,2) = m(0,0) * m(1,1) - m(0,1) * m(1,0);
+		
+		return n;
+	}
+	
+	
+	static Vector normalise (const Vector& vec)
+	{
+		float length = std::sqrt (vec.x * vec.x + vec.y * vec.y + vec.z * vec.z);
+		Vector result = vec;
+		
+		if (length > 0)
+		{
+			result.x /= length;
+			result.y /= length;
+			result.z /= length;
+		}
+		
+		return result;
+	}
+	
+	
+	
+	
+	/* constructor */
+	StaticBatch::StaticBatch (const TransformEvaluator* transforms, const Filter& filter, unsigned int threads)
+	{
+		plan (transforms, filter);
+		
+		
+		/* every range owns its slice of the preallocated buffers */
+		ThreadPool pool (threads);
+		
+		pool.parallelFor (mRanges.size(), 16, [&] (size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				write (transforms, mRanges[i]);
+		});
+	}
+	
+	
+	
+	
+	/* lay out the ranges and allocate the buffers */
+	void StaticBatch::plan (const TransformEvaluator* transforms, const Filter& filter)
+	{
+		std::unordered_map<const Material*, size_t> batches;
+		
+		
+		for (size_t n = 0; n < transforms->getNodeCount(); n++)
+		{
+			const Node* node = transforms->getNode (n);
+			const GeometryInstanceList& instances = node->getGeometries ();
+			
+			for (size_t i = 0; i < instances.size(); i++)
+			{
+				const GeometryInstance* instance = instances[i];
+				
+				const Geometry* geometry = instance->getGeometry ();
+				
+				if (!geometry || (filter && !filter (node, instance)))
+					continue;
+				
+				
+				const std::vector<Primitive*>& primitives = geometry->getPrimitives ();
+				
+				for (size_t p = 0; p < primitives.size(); p++)
+				{
+					/* find the bound material, unbound primitives share a batch */
+					const Material* material = instance->getMaterial (primitives[p]->getMaterial());
+					
+					
+					std::pair<std::unordered_map<const Material*, size_t>::iterator, bool> inserted;
+					inserted = batches.insert (std::make_pair (material, mBatches.size()));
+					
+					if (inserted.second)
+					{
+						mBatches.push_back (Batch ());
+						mBatches.back().material = material;
+					}
+					
+					
+					/* every index becomes a vertex since the inputs of a
+					 * primitive may each be indexed separately */
+					Batch& batch = mBatches[inserted.first->second];
+					size_t count = primitives[p]->getIndexCount ();
+					
+					Range range;
+					range.node        = node;
+					range.geometry    = instance;
+					range.primitive   = primitives[p];
+					range.transform   = n;
+					range.batch       = inserted.first->second;
+					range.firstVertex = batch.vertices.size ();
+					range.vertexCount = count;
+					range.firstIndex  = batch.indices.size ();
+					range.indexCount  = count;
+					
+					/* reserve the slice, the buffers are only sized here */
+					batch.vertices.resize (batch.vertices.size() + count);
+					batch.indices.resize (batch.indices.size() + count);
+					
+					mRanges.push_back (range);
+				}
+			}
+		}
+	}
+	
+	
+	
+	
+	/* transform an instance primitive into its slice */
+	void StaticBatch::write (const TransformEvaluator* transforms, const Range& range)
+	{
+		const Matrix& world = transforms->getWorldMatrix (range.transform);
+		Matrix normals = normalMatrix (world);
+		
+		const Primitive* primitive = range.primitive;
+		Batch& batch = mBatches[range.batch];
+		
+		bool hasNormals = primitive->hasNormals ();
+		bool hasTexCoords = primitive->hasTexCoords ();
+		
+		
+		Vertex* vertices = &batch.vertices[range.firstVertex];
+		unsigned int* indices = &batch.indices[range.firstIndex];
+		
+		for (size_t i = 0; i < range.vertexCount; i++)
+		{
+			Vertex& vertex = vertices[i];
+			vertex.position = world.transformPoint (primitive->getVertex (i));
+			
+			vertex.normal.x = vertex.normal.y = vertex.normal.z = 0;
+			vertex.texcoord.u = vertex.texcoord.v = 0;
+			
+			if (hasNormals)
+				vertex.normal = normalise (normals.transformVector (primitive->getNormal (i)));
+			
+			if (hasTexCoords)
+				vertex.texcoord = primitive->getTexCoord (i);
+			
+			indices[i] = range.firstVertex + i;
+		}
+	}
+
+}
@@ -0,0 +1,161 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+
+
+#include "StringPool.h"
+
+#include <stdexcept>
+
+
+namespace ColladaParser
+{
+
+	/* the pool current on this thread */
+	static thread_local const std::shared_ptr<StringPool>* sCurrent = 0;
+	
+	static const std::string sEmpty;
+	
+	
+	
+	/* total distinct strings */
+	size_t StringStats::getStrings () const
+	{
+		size_t strings = 0;
+		
+		for (int i = 0; i < STRING_CATEGORY_COUNT; i++)
+			strings += categories[i].strings;
+		
+		return strings;
+	}
+	
+	
+	/* total bytes */
+	size_t StringStats::getBytes () const
+	{
+		size_t bytes = 0;
+		
+		for (int i = 0; i < STRING_CATEGORY_COUNT; i++)
+			bytes += categories[i].bytes;
+		
+		return bytes;
+	}
+	
+	
+	
+	
+	/* empty string */
+	InternedString::InternedString () : mString(&sEmpty)
+	{
+	}
+	
+	
+	
+	
+	/* constructor */
+	StringPool::StringPool ()
+	{
+	}
+	
+	
+	/* destructor */
+	StringPool::~StringPool ()
+	{
+	}
+	
+	
+	
+	/* find or add a string */
+	InternedString StringPool::intern (const std::string& text, StringCategory category)
+	{
+		if (text.empty())
+			return InternedString ();
+		
+		
+		std::lock_guard<std::mutex> lock (mMutex);
+		std::pair<std::unordered_set<std::string>::iterator, bool> result = mStrings.insert (text);
+		
+		StringStats::Category& stats = mStats.categories[category];
+		stats.references++;
+		
+		if (result.second)
+		{
+			const std::string& string = *result.first;
+			
+			/* the set node, plus the text when it is too long to be
+			 * stored inside the string itself */
+			size_t bytes = sizeof (std::string) + 2 * sizeof (void*);
+			
+			if (string.capacity() >= sizeof (std::string))
+				bytes += string.capacity() + 1;
+			
+			stats.strings++;
+			stats.bytes += bytes;
+		}
+		
+		return InternedString (&*result.first);
+	}
+	
+	
+	
+	/* memory held */
+	StringStats StringPool::getStats () const
+	{
+		std::lock_guard<std::mutex> lock (mMutex);
+		return mStats;
+	}
+	
+	
+	
+	/* current pool */
+	StringPool* StringPool::getCurrent ()
+	{
+		if (!sCurrent)
+			throw std::runtime_error ("No string pool is current");
+		
+		return sCurrent->get();
+	}
+	
+	
+	/* current or new pool */
+	std::shared_ptr<StringPool> StringPool::acquire ()
+	{
+		return sCurrent ? *sCurrent : std::make_shared<StringPool> ();
+	}
+	
+	
+	
+	/* make the pool current */
+	StringPool::Scope::Scope (const std::shared_ptr<StringPool>& pool) : mPrevious(sCurrent)
+	{
+		sCurrent = &pool;
+	}
+	
+	
+	/* restore the previous pool */
+	StringPool::Scope::~Scope ()
+	{
+		sCurrent = mPrevious;
+	}
+
+}
@@ -0,0 +1,208 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+
+namespace ColladaParser
+{
+
+	/* chunks of a single parallel for */
+	struct ThreadPool::Batch
+	{
+		const RangeTask* task;
+		
+		size_t count;
+		size_t grain;
+		size_t chunks;
+		
+		std::atomic<size_t> next;
+		std::atomic<size_t> remaining;
+		unsigned int users;
+		
+		std::mutex errorMutex;
+		std::exception_ptr error;
+	};
+	
+	
+	
+	
+	/* constructor */
+	ThreadPool::ThreadPool (unsigned int threads) : mStopping(false)
+	{
+		if (threads == 0)
+			threads = std::thread::hardware_concurrency ();
+		
+		/* the caller counts as a thread */
+		for (unsigned int i = 1; i < threads; i++)
+			mWorkers.push_back (std::thread (&ThreadPool::work, this));
+	}
+	
+	
+	/* destructor */
+	ThreadPool::~ThreadPool ()
+	{
+		{
+			std::lock_guard<std::mutex> lock (mMutex);
+			mStopping = true;
+		}
+		
+		mWake.notify_all ();
+		
+		for (size_t i = 0; i < mWorkers.size(); i++)
+			mWorkers[i].join ();
+	}
+	
+	
+	
+	
+	/* run chunks until the batch is exhausted */
+	void ThreadPool::runChunks (Batch* batch)
+	{
+		while (true)
+		{
+			size_t chunk = batch->next++;
+			
+			if (chunk >= batch->chunks)
+				break;
+			
+			size_t begin = chunk * batch->grain;
+			size_t end = std::min (begin + batch->grain, batch->count);
+			
+			try
+			{
+				(*batch->task) (begin, end);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock (batch->errorMutex);
+				if (!batch->error) batch->error = std::current_exception ();
+			}
+			
+			batch->remaining--;
+		}
+	}
+	
+	
+	
+	
+	/* worker thread loop */
+	void ThreadPool::work ()
+	{
+		std::unique_lock<std::mutex> lock (mMutex);
+		
+		while (true)
+		{
+			while (!mStopping && mQueue.empty())
+				mWake.wait (lock);
+			
+			if (mQueue.empty())
+				return;
+			
+			
+			/* exhausted batches are only waiting on their stragglers */
+			Batch* batch = mQueue.front ();
+			
+			if (batch->next >= batch->chunks)
+			{
+				mQueue.pop_front ();
+				continue;
+			}
+			
+			
+			batch->users++;
+			lock.unlock ();
+			
+			runChunks (batch);
+			
+			lock.lock ();
+			batch->users--;
+			
+			if (batch->remaining == 0 && batch->users == 0)
+				mDone.notify_all ();
+		}
+	}
+	
+	
+	
+	
+	/* split a range over the pool */
+	void ThreadPool::parallelFor (size_t count, size_t grain, const RangeTask& task)
+	{
+		if (count == 0)
+			return;
+		
+		if (grain == 0)
+			grain = 1;
+		
+		
+		/* not worth waking anyone up */
+		if (mWorkers.empty() || count <= grain)
+		{
+			task (0, count);
+			return;
+		}
+		
+		
+		Batch batch;
+		batch.task = &task;
+		batch.count = count;
+		batch.grain = grain;
+		batch.chunks = (count + grain - 1) / grain;
+		batch.next = 0;
+		batch.remaining = batch.chunks;
+		batch.users = 0;
+		
+		{
+			std::lock_guard<std::mutex> lock (mMutex);
+			mQueue.push_back (&batch);
+		}
+		
+		mWake.notify_all ();
+		
+		
+		/* take part in the work ourselves */
+		runChunks (&batch);
+		
+		
+		/* wait for the stragglers */
+		{
+			std::unique_lock<std::mutex> lock (mMutex);
+			
+			std::deque<Batch*>::iterator iter = std::find (mQueue.begin(), mQueue.end(), &batch);
+			if (iter != mQueue.end()) mQueue.erase (iter);
+			
+			while (batch.remaining != 0 || batch.users != 0)
+				mDone.wait (lock);
+		}
+		
+		
+		if (batch.error)
+			std::rethrow_exception (batch.error);
+	}
+
+}
@@ -22,29 +22,127 @@ THE SOFTWARE.
 
 #include "Transform.h"
 
+#include <locale>
 #include <stdexcept>
 #include <ticpp/ticpp.h>
 
+#include "Cache.h"
+#include "Node.h"
+
 
 namespace ColladaParser
 {
 
 	/* constructor */
-	Transform::Transform (Type type, ticpp::Element* element) : mType(type)
+	Transform::Transform (Type type, ticpp::Element* element) : mType(type), mNode(0)
 	{
 		parse (element);
 	}
 	
 	
 	
+	/* constructor */
+	Transform::Transform (CacheReader& reader) : mNode(0)
+	{
+		mType = Type (reader.read<uint32_t> ());
+		mSID  = StringPool::getCurrent()->intern (reader.readString (), STRING_SID);
+		
+		reader.read (&mVector,   sizeof (mVector));
+		reader.read (&mRotation, sizeof (mRotation));
+		reader.read (&mAngle,    sizeof (mAngle));
+		reader.read (&mMatrix,   sizeof (mMatrix));
+	}
+	
+	
+	/* write transform */
+	void Transform::write (CacheWriter& writer) const
+	{
+		writer.write (uint32_t (mType));
+		writer.writeString (mSID);
+		
+		writer.write (mVector);
+		writer.write (mRotation);
+		writer.write (mAngle);
+		writer.write (mMatrix);
+	}
+	
+	
+	
+	/* set translation */
+	void Transform::setTranslation (const Vector& translation)
+	{
+		mType = TRANSLATE;
+		mVector = translation;
+		mMatrix = Matrix::translation (mVector);
+		
+		touch ();
+	}
+	
+	
+	/* set scale */
+	void Transform::setScale (const Vector& scale)
+	{
+		mType = SCALE;
+		mVector = scale;
+		mMatrix = Matrix::scale (mVector);
+		
+		touch ();
+	}
+	
+	
+	/* set rotation */
+	void Transform::setRotation (const Vector& axis, float angle)
+	{
+		mType = ROTATE;
+		mVector = axis;
+		mAngle = angle;
+		
+		mRotation.x = mRotation.y = mRotation.z = 0;
+		
+		if      (axis.x) mRotation.x = angle;
+		else if (axis.y) mRotation.y = angle;
+		else if (axis.z) mRotation.z = angle;
+		
+		mMatrix = Matrix::rotation (mVector, mAngle);
+		
+		touch ();
+	}
+	
+	
+	/* set matrix */
+	void Transform::setMatrix (const Matrix& matrix)
+	{
+		mType = MATRIX;
+		mMatrix = matrix;
+		
+		touch ();
+	}
+	
+	
+	/* the owning node changed */
+	void Transform::touch ()
+	{
+		if (mNode)
+			mNode->changed ();
+	}
+	
+	
+	
+	
 	/* parse transform element */
 	void Transform::parse (ticpp::Element* element)
 	{
-		mSID  = element->GetAttributeOrDefault ("sid", "");
+		mSID  = StringPool::getCurrent()->intern (element->GetAttributeOrDefault ("sid", ""), STRING_SID);
 		
 		/* get transformation data */
 		std::string data = element->GetText();
 		std::istringstream stream (data);
+		stream.imbue (std::locale::classic ());
+		
+		
+		mVector.x = mVector.y = mVector.z = 0;
+		mRotation = mVector;
+		mAngle = 0;
 		
 		
 		/* parse data according to type */
@@ -52,29 +150,59 @@ namespace ColladaParser
 		{
 		case TRANSLATE:
 			/* parse data: '[x] [y] [z]' */
-			stream >> mData.vec.x >> mData.vec.y >> mData.vec.z;
+			stream >> mVector.x >> mVector.y >> mVector.z;
+			mMatrix = Matrix::translation (mVector);
 			break;
 			
 		case SCALE:
 			/* parse data: '[x] [y] [z]' */
-			stream >> mData.vec.x >> mData.vec.y >> mData.vec.z;
+			stream >> mVector.x >> mVector.y >> mVector.z;
+			mMatrix = Matrix::scale (mVector);
 			break;
 			
 		case ROTATE:
 			/* parse data: '[x] [y] [z] [angle]' */
-			float x, y, z, angle;
-			stream >> x >> y >> z >> angle;
+			stream >> mVector.x >> mVector.y >> mVector.z >> mAngle;
 			
-			mData.vec.x = 0;
-			mData.vec.y = 0;
-			mData.vec.z = 0;
+			if      (mVector.x) mRotation.x = mAngle;
+			else if (mVector.y) mRotation.y = mAngle;
+			else if (mVector.z) mRotation.z = mAngle;
+			
+			mMatrix = Matrix::rotation (mVector, mAngle);
+			break;
 			
-			if      (x) mData.vec.x = angle;
-			else if (y) mData.vec.y = angle;
-			else if (z) mData.vec.z = angle;
+		case MATRIX:
+			/* parse data: 16 floats in row-major order */
+			for (int row = 0; row < 4; row++)
+				for (int col = 0; col < 4; col++)
+					stream >> mMatrix(row, col);
+			break;
+			
+		case LOOK_AT:
+		{
+			/* parse data: '[eye] [interest] [up]' */
+			Vector eye, interest, up;
+			stream >> eye.x >> eye.y >> eye.z;
+			stream >> interest.x >> interest.y >> interest.z;
+			stream >> up.x >> up.y >> up.z;
 			
+			mMatrix = Matrix::lookAt (eye, interest, up);
 			break;
 		}
+			
+		case SKEW:
+		{
+			/* parse data: '[angle] [rotation axis] [translation axis]' */
+			Vector rotation, translation;
+			stream >> mAngle;
+			stream >> rotation.x >> rotation.y >> rotation.z;
+			stream >> translation.x >> translation.y >> translation.z;
+			
+			mVector = rotation;
+			mMatrix = Matrix::skew (mAngle, rotation, translation);
+			break;
+		}
+		}
 	}
 
 }
@@ -0,0 +1,335 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "TransformEvaluator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "ThreadPool.h"
+
+
+namespace ColladaParser
+{
+
+	/* levels narrower than this aren't worth splitting */
+	static const size_t LEVEL_GRAIN = 512;
+	
+	
+	
+	
+	/* constructor */
+	TransformEvaluator::TransformEvaluator (const VisualScene* scene, unsigned int threads)
+	: mPool (new ThreadPool (threads))
+	{
+		flatten (scene);
+	}
+	
+	
+	/* destructor */
+	TransformEvaluator::~TransformEvaluator ()
+	{
+		/* stop watching the scene */
+		for (size_t i = 0; i < mNodes.size(); i++)
+		{
+			std::vector<TransformEvaluator*>& evaluators = mNodes[i]->mEvaluators;
+			evaluators.erase (std::remove (evaluators.begin(), evaluators.end(), this), evaluators.end());
+		}
+		
+		delete mPool;
+	}
+	
+	
+	
+	
+	/* flatten hierarchy breadth first */
+	void TransformEvaluator::flatten (const VisualScene* scene)
+	{
+		const NodeList& roots = scene->getNodes ();
+		
+		for (size_t i = 0; i < roots.size(); i++)
+		{
+			mNodes.push_back (roots[i]);
+			mParents.push_back (-1);
+		}
+		
+		mLevels.push_back (0);
+		
+		
+		/* each pass appends the children of the previous level */
+		size_t begin = 0;
+		
+		while (begin < mNodes.size())
+		{
+			size_t end = mNodes.size ();
+			
+			for (size_t i = begin; i < end; i++)
+			{
+				const NodeList& children = mNodes[i]->getChildren ();
+				mChildBegin.push_back (mNodes.size());
+				
+				for (size_t c = 0; c < children.size(); c++)
+				{
+					mNodes.push_back (children[c]);
+					mParents.push_back (i);
+				}
+				
+				mChildEnd.push_back (mNodes.size());
+			}
+			
+			mLevels.push_back (end);
+			begin = end;
+		}
+		
+		
+		/* node lookup, and watch the nodes for set transforms */
+		for (size_t i = 0; i < mNodes.size(); i++)
+		{
+			mIndices[mNodes[i]] = i;
+			mNodes[i]->mEvaluators.push_back (this);
+		}
+		
+		mLocal.resize (mNodes.size(), Matrix::identity ());
+		mWorld.resize (mNodes.size(), Matrix::identity ());
+		mDirty.resize (mNodes.size(), CLEAN);
+	}
+	
+	
+	
+	
+	/* find node index */
+	int TransformEvaluator::getIndex (const Node* node) const
+	{
+		std::unordered_map<const Node*, size_t>::const_iterator iter = mIndices.find (node);
+		return iter == mIndices.end() ? -1 : iter->second;
+	}
+	
+	
+	/* find node index or fail */
+	size_t TransformEvaluator::checkIndex (const Node* node) const
+	{
+		int index = getIndex (node);
+		
+		if (index < 0)
+			throw std::runtime_error ("Node '" + node->getID() + "' is not part of the evaluated scene");
+		
+		return index;
+	}
+	
+	
+	/* get node world matrix */
+	const Matrix& TransformEvaluator::getWorldMatrix (const Node* node) const
+	{
+		return mWorld[checkIndex (node)];
+	}
+	
+	
+	
+	
+	/* concatenate a range of nodes with their parents */
+	void TransformEvaluator::propagate (size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			if (mParents[i] < 0)
+				mWorld[i] = mLocal[i];
+			else
+				multiply (mWorld[mParents[i]], mLocal[i], mWorld[i]);
+		}
+	}
+	
+	
+	
+	
+	/* concatenate a whole subtree with its parents */
+	void TransformEvaluator::propagateSubtree (size_t root)
+	{
+		std::vector<size_t> stack (1, root);
+		
+		while (!stack.empty())
+		{
+			size_t index = stack.back ();
+			stack.pop_back ();
+			
+			propagate (index, index + 1);
+			
+			for (size_t child = mChildBegin[index]; child < mChildEnd[index]; child++)
+				stack.push_back (child);
+		}
+	}
+	
+	
+	
+	
+	/* evaluate all matrices */
+	void TransformEvaluator::evaluate ()
+	{
+		/* local matrices are independent of each other */
+		mPool->parallelFor (mNodes.size(), LEVEL_GRAIN, [this] (size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				mLocal[i] = mNodes[i]->getLocalMatrix ();
+		});
+		
+		
+		/* a level only depends on the level above it */
+		for (size_t level = 0; level + 1 < mLevels.size(); level++)
+		{
+			size_t first = mLevels[level];
+			size_t count = mLevels[level + 1] - first;
+			
+			mPool->parallelFor (count, LEVEL_GRAIN, [this, first] (size_t begin, size_t end)
+			{
+				propagate (first + begin, first + end);
+			});
+		}
+		
+		
+		/* everything is up to date */
+		for (size_t i = 0; i < mDirtyList.size(); i++)
+			mDirty[mDirtyList[i]] = CLEAN;
+		
+		mDirtyList.clear ();
+	}
+	
+	
+	
+	
+	/* flag a node for the next update */
+	void TransformEvaluator::markDirty (size_t index, DirtyState state)
+	{
+		if (mDirty[index] == CLEAN)
+			mDirtyList.push_back (index);
+		
+		if (state > mDirty[index])
+			mDirty[index] = state;
+	}
+	
+	
+	/* transform stack changed */
+	void TransformEvaluator::invalidate (size_t index)
+	{
+		markDirty (index, DIRTY_LOCAL);
+	}
+	
+	
+	void TransformEvaluator::invalidate (const Node* node)
+	{
+		invalidate (checkIndex (node));
+	}
+	
+	
+	/* local matrix override */
+	void TransformEvaluator::setLocalMatrix (size_t index, const Matrix& local)
+	{
+		mLocal[index] = local;
+		
+		/* the override wins over any pending recomposition */
+		if (mDirty[index] == CLEAN)
+			mDirtyList.push_back (index);
+		
+		mDirty[index] = DIRTY_WORLD;
+	}
+	
+	
+	void TransformEvaluator::setLocalMatrix (const Node* node, const Matrix& local)
+	{
+		setLocalMatrix (checkIndex (node), local);
+	}
+	
+	
+	
+	
+	/* recompute dirty subtrees */
+	void TransformEvaluator::update ()
+	{
+		if (mDirtyList.empty())
+			return;
+		
+		
+		/* recompose stale local matrices */
+		mPool->parallelFor (mDirtyList.size(), LEVEL_GRAIN, [this] (size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				size_t index = mDirtyList[i];
+				
+				if (mDirty[index] == DIRTY_LOCAL)
+					mLocal[index] = mNodes[index]->getLocalMatrix ();
+			}
+		});
+		
+		
+		/* only the topmost dirty nodes need propagating since their
+		 * subtrees cover every other dirty node */
+		std::vector<size_t> roots;
+		
+		for (size_t i = 0; i < mDirtyList.size(); i++)
+		{
+			int parent = mParents[mDirtyList[i]];
+			
+			while (parent >= 0 && mDirty[parent] == CLEAN)
+				parent = mParents[parent];
+			
+			if (parent < 0)
+				roots.push_back (mDirtyList[i]);
+		}
+		
+		
+		/* a few large subtrees don't spread well, so step down until
+		 * there are enough independent subtrees to go around */
+		size_t threads = mPool->getThreadCount ();
+		
+		while (!roots.empty() && roots.size() < threads)
+		{
+			std::vector<size_t> children;
+			
+			for (size_t i = 0; i < roots.size(); i++)
+			{
+				propagate (roots[i], roots[i] + 1);
+				
+				for (size_t c = mChildBegin[roots[i]]; c < mChildEnd[roots[i]]; c++)
+					children.push_back (c);
+			}
+			
+			roots.swap (children);
+		}
+		
+		
+		/* independent subtrees */
+		size_t grain = roots.size() / (threads * 8) + 1;
+		
+		mPool->parallelFor (roots.size(), grain, [this, &roots] (size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				propagateSubtree (roots[i]);
+		});
+		
+		
+		for (size_t i = 0; i < mDirtyList.size(); i++)
+			mDirty[mDirtyList[i]] = CLEAN;
+		
+		mDirtyList.clear ();
+	}
+
+}
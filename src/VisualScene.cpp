@@ -25,20 +25,107 @@ THE SOFTWARE.
 #include <stdexcept>
 #include <ticpp/ticpp.h>
 
+#include "Cache.h"
+
 
 namespace ColladaParser
 {
 
 	/* constructor */
 	VisualScene::VisualScene (ticpp::Element *element)
+	: mStrings (StringPool::acquire ())
+	{
+		StringPool::Scope scope (mStrings);
+		
+		try
+		{
+			parse (element);
+		}
+		catch (...)
+		{
+			release ();
+			throw;
+		}
+	}
+	
+	
+	/* constructor with parsed nodes */
+	VisualScene::VisualScene (ticpp::Element *element, const NodeList& nodes)
+	: mStrings (StringPool::acquire ()),
+	  mNodes (nodes)
+	{
+		StringPool::Scope scope (mStrings);
+		
+		try
+		{
+			parse (element);
+		}
+		catch (...)
+		{
+			release ();
+			throw;
+		}
+	}
+	
+	
+	
+	/* constructor from a cache */
+	VisualScene::VisualScene (CacheReader& reader)
+	: mStrings (StringPool::acquire ())
 	{
-		parse (element);
+		static const uint32_t ROOT = uint32_t (-1);
+		StringPool::Scope scope (mStrings);
+		
+		try
+		{
+			mID   = mStrings->intern (reader.readString (), STRING_ID);
+			mName = mStrings->intern (reader.readString (), STRING_NAME);
+			
+			uint32_t count = reader.read<uint32_t> ();
+			NodeList table;
+			
+			for (uint32_t i = 0; i < count; i++)
+			{
+				uint32_t parent = reader.read<uint32_t> ();
+				Node* node = new Node (reader);
+				
+				/* parents always come before their children */
+				if (parent == ROOT)
+					mNodes.push_back (node);
+				
+				else if (parent < table.size())
+				{
+					node->mParent = table[parent];
+					table[parent]->mChildren.push_back (node);
+				}
+				
+				else
+				{
+					delete node;
+					throw std::runtime_error ("Invalid cache file: Unknown parent node");
+				}
+				
+				table.push_back (node);
+			}
+		}
+		catch (...)
+		{
+			release ();
+			throw;
+		}
 	}
 	
 	
 	
 	/* destructor */
 	VisualScene::~VisualScene ()
+	{
+		release ();
+	}
+	
+	
+	/* free the node tree */
+	void VisualScene::release ()
 	{
 		/* free nodes */
 		NodeList::iterator iter;
@@ -50,6 +137,56 @@ namespace ColladaParser
 	
 	
 	
+	/* write scene with a flat node table */
+	void VisualScene::write (CacheWriter& writer) const
+	{
+		std::vector<std::pair<const Node*, uint32_t> > stack;
+		uint32_t index = 0;
+		
+		/* count the nodes first */
+		for (size_t i = mNodes.size(); i > 0; i--)
+			stack.push_back (std::make_pair (mNodes[i - 1], uint32_t (-1)));
+		
+		while (!stack.empty())
+		{
+			const Node* node = stack.back().first;
+			stack.pop_back ();
+			index++;
+			
+			for (size_t i = node->mChildren.size(); i > 0; i--)
+				stack.push_back (std::make_pair (node->mChildren[i - 1], 0));
+		}
+		
+		
+		writer.writeString (mID);
+		writer.writeString (mName);
+		writer.write (index);
+		
+		
+		/* depth first so each parent is written before its children */
+		for (size_t i = mNodes.size(); i > 0; i--)
+			stack.push_back (std::make_pair (mNodes[i - 1], uint32_t (-1)));
+		
+		index = 0;
+		
+		while (!stack.empty())
+		{
+			const Node* node = stack.back().first;
+			uint32_t parent = stack.back().second;
+			stack.pop_back ();
+			
+			writer.write (parent);
+			node->write (writer);
+			
+			for (size_t i = node->mChildren.size(); i > 0; i--)
+				stack.push_back (std::make_pair (node->mChildren[i - 1], index));
+			
+			index++;
+		}
+	}
+	
+	
+	
 	/* parse visual_scene element */
 	void VisualScene::parse (ticpp::Element* element)
 	{
@@ -57,8 +194,8 @@ namespace ColladaParser
 		
 		
 		/* scene properties */
-		mID   = element->GetAttributeOrDefault ("id", "");
-		mName = element->GetAttributeOrDefault ("name", "");
+		mID   = mStrings->intern (element->GetAttributeOrDefault ("id", ""), STRING_ID);
+		mName = mStrings->intern (element->GetAttributeOrDefault ("name", ""), STRING_NAME);
 		
 		
 		/* sift through visual_scene elements
@@ -77,7 +214,7 @@ namespace ColladaParser
 		/* no node found */
 		if (mNodes.size() == 0)
 			throw std::runtime_error ("Parsing failed: No node specified in "
-					"visual scene '" + mID + " (" + mName + ")'");
+					"visual scene '" + mID.str() + " (" + mName.str() + ")'");
 	}
 
 }
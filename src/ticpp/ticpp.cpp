@@ -851,6 +851,11 @@ void Document::Parse( const std::string& xml, bool throwIfParseError, TiXmlEncod
 	}
 }
 
+void Document::SetCondenseWhiteSpace( bool condense )
+{
+	m_tiXmlPointer->SetDocumentWhiteSpaceCondensed( condense );
+}
+
 //*****************************************************************************
 
 Element::Element()
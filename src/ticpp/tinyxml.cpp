@@ -31,7 +31,7 @@ distribution.
 #endif
 
 
-bool TiXmlBase::condenseWhiteSpace = true;
+std::atomic<bool> TiXmlBase::condenseWhiteSpace( true );
 
 // Microsoft compiler security
 FILE* TiXmlFOpen( const char* filename, const char* mode )
@@ -884,6 +884,7 @@ TiXmlDocument::TiXmlDocument() : TiXmlNode( TiXmlNode::DOCUMENT )
 {
 	tabsize = 4;
 	useMicrosoftBOM = false;
+	documentCondenseWhiteSpace = IsWhiteSpaceCondensed();
 	ClearError();
 }
 
@@ -891,6 +892,7 @@ TiXmlDocument::TiXmlDocument( const char * documentName ) : TiXmlNode( TiXmlNode
 {
 	tabsize = 4;
 	useMicrosoftBOM = false;
+	documentCondenseWhiteSpace = IsWhiteSpaceCondensed();
 	value = documentName;
 	ClearError();
 }
@@ -901,6 +903,7 @@ TiXmlDocument::TiXmlDocument( const std::string& documentName ) : TiXmlNode( TiX
 {
 	tabsize = 4;
 	useMicrosoftBOM = false;
+	documentCondenseWhiteSpace = IsWhiteSpaceCondensed();
     value = documentName;
 	ClearError();
 }
@@ -1125,6 +1128,7 @@ void TiXmlDocument::CopyTo( TiXmlDocument* target ) const
 	target->tabsize = tabsize;
 	target->errorLocation = errorLocation;
 	target->useMicrosoftBOM = useMicrosoftBOM;
+	target->documentCondenseWhiteSpace = documentCondenseWhiteSpace;
 
 	TiXmlNode* node = 0;
 	for ( node = firstChild; node; node = node->NextSibling() )
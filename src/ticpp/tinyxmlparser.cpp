@@ -176,23 +176,35 @@ class TiXmlParsingData
 
 	const TiXmlCursor& Cursor()	{ return cursor; }
 
+	// White space setting of the document being parsed.
+	bool CondenseWhiteSpace() const	{ return condenseWhiteSpace; }
+
   private:
 	// Only used by the document!
-	TiXmlParsingData( const char* start, int _tabsize, int row, int col )
+	TiXmlParsingData( const char* start, int _tabsize, int row, int col, bool condense )
 	{
 		assert( start );
 		stamp = start;
 		tabsize = _tabsize;
 		cursor.row = row;
 		cursor.col = col;
+		condenseWhiteSpace = condense;
 	}
 
 	TiXmlCursor		cursor;
 	const char*		stamp;
 	int				tabsize;
+	bool			condenseWhiteSpace;
 };
 
 
+// Nodes parsed outside of a document use the global default.
+static bool IsCondensed( const TiXmlParsingData* data )
+{
+	return data ? data->CondenseWhiteSpace() : TiXmlBase::IsWhiteSpaceCondensed();
+}
+
+
 void TiXmlParsingData::Stamp( const char* now, TiXmlEncoding encoding )
 {
 	assert( now );
@@ -576,11 +588,12 @@ const char* TiXmlBase::ReadText(	const char* p,
 									bool trimWhiteSpace,
 									const char* endTag,
 									bool caseInsensitive,
-									TiXmlEncoding encoding )
+									TiXmlEncoding encoding,
+									bool condense )
 {
     *text = "";
 	if (    !trimWhiteSpace			// certain tags always keep whitespace
-		 || !condenseWhiteSpace )	// if true, whitespace is always kept
+		 || !condense )				// if true, whitespace is always kept
 	{
 		// Keep all the white space.
 		while (	   p && *p
@@ -728,7 +741,7 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 		location.row = 0;
 		location.col = 0;
 	}
-	TiXmlParsingData data( p, TabSize(), location.row, location.col );
+	TiXmlParsingData data( p, TabSize(), location.row, location.col, documentCondenseWhiteSpace );
 	location = data.Cursor();
 
 	if ( encoding == TIXML_ENCODING_UNKNOWN )
@@ -1204,7 +1217,7 @@ const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXm
 				    return 0;
 			}
 
-			if ( TiXmlBase::IsWhiteSpaceCondensed() )
+			if ( IsCondensed( data ) )
 			{
 				p = textNode->Parse( p, data, encoding );
 			}
@@ -1440,13 +1453,13 @@ const char* TiXmlAttribute::Parse( const char* p, TiXmlParsingData* data, TiXmlE
 	{
 		++p;
 		end = "\'";		// single quote in string
-		p = ReadText( p, &value, false, end, false, encoding );
+		p = ReadText( p, &value, false, end, false, encoding, IsCondensed( data ) );
 	}
 	else if ( *p == DOUBLE_QUOTE )
 	{
 		++p;
 		end = "\"";		// double quote in string
-		p = ReadText( p, &value, false, end, false, encoding );
+		p = ReadText( p, &value, false, end, false, encoding, IsCondensed( data ) );
 	}
 	else
 	{
@@ -1539,7 +1552,7 @@ const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncodi
 		}
 
 		TIXML_STRING dummy;
-		p = ReadText( p, &dummy, false, endTag, false, encoding );
+		p = ReadText( p, &dummy, false, endTag, false, encoding, IsCondensed( data ) );
 		return p;
 	}
 	else
@@ -1547,7 +1560,7 @@ const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncodi
 		bool ignoreWhite = true;
 
 		const char* end = "<";
-		p = ReadText( p, &value, ignoreWhite, end, false, encoding );
+		p = ReadText( p, &value, ignoreWhite, end, false, encoding, IsCondensed( data ) );
 		if ( p )
 			return p-1;	// don't truncate the '<'
 		return 0;
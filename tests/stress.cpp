@@ -0,0 +1,350 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+
+/* stress
+ * 
+ * Opens the same generated document on many threads at once, eagerly,
+ * lazily and with parallel parsing, and checks every copy against one
+ * opened on its own. Lazy mode also shares a single document between the
+ * threads. Meant to be run under -fsanitize=thread as well.
+ * 
+ * usage: collada-stress file [threads]
+ */
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <stdexcept>
+
+#include <ColladaParser/Document.h>
+
+
+using namespace ColladaParser;
+
+
+
+/* generated document size */
+static const int GEOMETRIES = 48;
+static const int EFFECTS = 8;
+static const int NODES = 128;
+static const int VERTICES = 90;
+
+
+
+/* write a document with enough elements to spread over the threads */
+static void generate (const std::string& file)
+{
+	std::ofstream stream (file.c_str());
+	
+	if (!stream)
+		throw std::runtime_error ("Failed to write '" + file + "'");
+	
+	
+	stream << "<?xml version=\"1.0\"?>\n<COLLADA version=\"1.4.1\">\n";
+	stream << "<asset><unit meter=\"0.01\" name=\"cm\"/><up_axis>Y_UP</up_axis></asset>\n";
+	
+	stream << "<library_effects>\n";
+	
+	for (int e = 0; e < EFFECTS; e++)
+		stream << "<effect id=\"E" << e << "\"><profile_COMMON><technique sid=\"c\"><lambert><diffuse><color>"
+		       << e << " 1 1 1</color></diffuse></lambert></technique></profile_COMMON></effect>\n";
+	
+	stream << "</library_effects>\n<library_materials>\n";
+	
+	for (int e = 0; e < EFFECTS; e++)
+		stream << "<material id=\"M" << e << "\"><instance_effect url=\"#E" << e << "\"/></material>\n";
+	
+	stream << "</library_materials>\n<library_geometries>\n";
+	
+	
+	for (int g = 0; g < GEOMETRIES; g++)
+	{
+		stream << "<geometry id=\"G" << g << "\"><mesh><source id=\"G" << g << "-p\"><float_array id=\"G" << g
+		       << "-a\" count=\"" << VERTICES * 3 << "\">";
+		
+		for (int v = 0; v < VERTICES * 3; v++)
+			stream << (g * 7 + v) % 101 * 0.25f << ' ';
+		
+		stream << "</float_array><technique_common><accessor source=\"#G" << g << "-a\" count=\"" << VERTICES
+		       << "\" stride=\"3\"><param name=\"X\" type=\"float\"/><param name=\"Y\" type=\"float\"/>"
+		       << "<param name=\"Z\" type=\"float\"/></accessor></technique_common></source>"
+		       << "<vertices id=\"G" << g << "-v\"><input semantic=\"POSITION\" source=\"#G" << g << "-p\"/></vertices>"
+		       << "<triangles material=\"m\" count=\"" << VERTICES / 3 << "\"><input semantic=\"VERTEX\" source=\"#G"
+		       << g << "-v\" offset=\"0\"/><p>";
+		
+		for (int v = 0; v < VERTICES; v++)
+			stream << (v * 31 + g) % VERTICES << ' ';
+		
+		stream << "</p></triangles></mesh></geometry>\n";
+	}
+	
+	
+	stream << "</library_geometries>\n<library_visual_scenes><visual_scene id=\"S\">\n";
+	
+	for (int n = 0; n < NODES; n++)
+		stream << "<node id=\"N" << n << "\" sid=\"n\"><translate sid=\"t\">" << n << " 0 0</translate>"
+		       << "<instance_geometry url=\"#G" << n % GEOMETRIES << "\"><bind_material><technique_common>"
+		       << "<instance_material symbol=\"m\" target=\"#M" << n % EFFECTS << "\"/></technique_common>"
+		       << "</bind_material></instance_geometry><node id=\"N" << n << "c\"><rotate>0 1 0 " << n
+		       << "</rotate><instance_geometry url=\"#G" << (n + 1) % GEOMETRIES << "\"/></node></node>\n";
+	
+	stream << "</visual_scene></library_visual_scenes>\n";
+	stream << "<scene><instance_visual_scene url=\"#S\"/></scene>\n</COLLADA>\n";
+	
+	if (!stream)
+		throw std::runtime_error ("Failed to write '" + file + "'");
+}
+
+
+
+/* what a document holds, compared between copies */
+struct Summary
+{
+	size_t materials;
+	size_t effects;
+	size_t geometries;
+	size_t nodes;
+	size_t indices;
+	size_t resolved;
+	size_t instanced;
+	double vertices;
+	double translation;
+	
+	Summary ()
+	: materials(0), effects(0), geometries(0), nodes(0),
+	  indices(0), resolved(0), instanced(0), vertices(0), translation(0) {}
+	
+	bool operator== (const Summary& other) const
+	{
+		return materials == other.materials && effects == other.effects &&
+		       geometries == other.geometries && nodes == other.nodes &&
+		       indices == other.indices && resolved == other.resolved &&
+		       instanced == other.instanced &&
+		       vertices == other.vertices && translation == other.translation;
+	}
+};
+
+
+/* read everything through the public getters */
+static Summary summarise (const Document& document)
+{
+	Summary summary;
+	
+	/* look some elements up before listing so lazy documents parse them
+	 * out of order */
+	for (int g = GEOMETRIES - 1; g >= 0; g -= 5)
+	{
+		char url[32];
+		std::snprintf (url, sizeof (url), "#G%d", g);
+		
+		Geometry* geometry = document.getGeometry (url);
+		summary.resolved += geometry != 0;
+	}
+	
+	summary.resolved += document.getNode ("N7c") != 0;
+	summary.resolved += document.resolveSID ("N3/t").transform != 0;
+	
+	/* instances of lazy documents resolve on first access */
+	const GeometryInstanceList& instances = document.getNode ("N5")->getGeometries ();
+	
+	for (size_t i = 0; i < instances.size(); i++)
+		summary.instanced += (instances[i]->getGeometry() != 0) + (instances[i]->getMaterial ("m") != 0);
+	
+	
+	summary.materials = document.getMaterials().size();
+	summary.effects = document.getEffects().size();
+	
+	const GeometryList& geometries = document.getGeometries ();
+	summary.geometries = geometries.size();
+	
+	for (size_t g = 0; g < geometries.size(); g++)
+	{
+		const std::vector<Primitive*>& primitives = geometries[g]->getPrimitives ();
+		
+		for (size_t p = 0; p < primitives.size(); p++)
+		{
+			int count = primitives[p]->getIndexCount ();
+			summary.indices += count;
+			
+			for (int i = 0; i < count; i++)
+			{
+				Vector vertex = primitives[p]->getVertex (i);
+				summary.vertices += vertex.x + vertex.y * 2 + vertex.z * 3;
+			}
+		}
+	}
+	
+	
+	const VisualSceneList& scenes = document.getVisualScenes ();
+	
+	for (size_t s = 0; s < scenes.size(); s++)
+	{
+		const NodeList& nodes = scenes[s]->getNodes ();
+		summary.nodes += nodes.size();
+		
+		for (size_t n = 0; n < nodes.size(); n++)
+		{
+			summary.nodes += nodes[n]->getChildren().size();
+			summary.translation += nodes[n]->getLocalMatrix().m[12];
+		}
+	}
+	
+	return summary;
+}
+
+
+
+enum Mode { EAGER, LAZY, PARALLEL };
+
+static const char* MODE_NAMES[] = { "eager", "lazy", "parallel" };
+
+
+/* open a private copy of the document */
+static Summary openCopy (const std::string& file, Mode mode)
+{
+	Document document (file);
+	
+	if (mode == LAZY)     document.setLazy (true);
+	if (mode == PARALLEL) document.setThreadCount (4);
+	
+	if (!document.open ())
+		throw std::runtime_error ("Failed to open '" + file + "'");
+	
+	return summarise (document);
+}
+
+
+
+/* run the same work on every thread and count mismatches */
+template <typename Work>
+static int runThreads (unsigned int threads, const Summary& expected, const char* name, Work work)
+{
+	std::vector<std::thread> workers;
+	std::vector<Summary> results (threads);
+	std::vector<std::string> errors (threads);
+	
+	for (unsigned int t = 0; t < threads; t++)
+	{
+		workers.push_back (std::thread ([&, t] ()
+		{
+			try
+			{
+				results[t] = work ();
+			}
+			catch (const std::exception& e)
+			{
+				errors[t] = e.what();
+			}
+		}));
+	}
+	
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join ();
+	
+	
+	int failed = 0;
+	
+	for (unsigned int t = 0; t < threads; t++)
+	{
+		if (!errors[t].empty())
+			std::printf ("%s: thread %u failed: %s\n", name, t, errors[t].c_str());
+		
+		else if (!(results[t] == expected))
+			std::printf ("%s: thread %u read a different document\n", name, t);
+		
+		else continue;
+		
+		failed++;
+	}
+	
+	std::printf ("%s: %u threads, %d failed\n", name, threads, failed);
+	return failed;
+}
+
+
+
+
+int main (int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::fprintf (stderr, "usage: collada-stress file [threads]\n");
+		return 2;
+	}
+	
+	std::string file = argv[1];
+	unsigned int threads = argc > 2 ? std::atoi (argv[2]) : std::thread::hardware_concurrency ();
+	
+	if (threads < 4)
+		threads = 4;
+	
+	
+	int failed = 0;
+	
+	try
+	{
+		generate (file);
+		
+		Summary expected = openCopy (file, EAGER);
+		
+		if (expected.geometries != size_t (GEOMETRIES) || expected.nodes != size_t (NODES * 2) || expected.resolved != 12 ||
+		    expected.instanced != 2)
+		{
+			std::printf ("reference: unexpected document contents\n");
+			return 1;
+		}
+		
+		
+		/* a document per thread */
+		for (int mode = EAGER; mode <= PARALLEL; mode++)
+		{
+			failed += runThreads (threads, expected, MODE_NAMES[mode], [&] ()
+			{
+				return openCopy (file, Mode (mode));
+			});
+		}
+		
+		
+		/* one lazy document read by every thread */
+		Document shared (file);
+		shared.setLazy (true);
+		shared.open ();
+		
+		failed += runThreads (threads, expected, "shared lazy", [&] ()
+		{
+			return summarise (shared);
+		});
+	}
+	catch (const std::exception& e)
+	{
+		std::printf ("stress failed: %s\n", e.what());
+		return 1;
+	}
+	
+	return failed > 0 ? 1 : 0;
+}
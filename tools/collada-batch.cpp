@@ -0,0 +1,530 @@
+/*
+Copyright (c) 2010 Goran Sterjov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+
+/* collada-batch
+ * 
+ * Converts many COLLADA files in one process. Files are parsed on a shared
+ * thread pool and each one is flattened into a binary mesh blob. Geometry
+ * ids and material symbols go through one interner so the blobs refer to
+ * a single string table written next to them.
+ * 
+ * usage: collada-batch [-j threads] [-m megabytes] [-o directory]
+ *                      [-l list] [file or directory]...
+ */
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <stdexcept>
+#include <stdint.h>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <dirent.h>
+#endif
+
+#include <ColladaParser/Document.h>
+#include <ColladaParser/ThreadPool.h>
+
+
+using namespace ColladaParser;
+
+
+namespace
+{
+
+	/* strings shared by every converted file */
+	class StringInterner
+	{
+	public:
+		uint32_t intern (const std::string& text)
+		{
+			std::lock_guard<std::mutex> lock (mMutex);
+			
+			std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> result;
+			result = mIndex.insert (std::make_pair (text, uint32_t (mStrings.size())));
+			
+			if (result.second)
+				mStrings.push_back (text);
+			
+			return result.first->second;
+		}
+		
+		
+		size_t getCount() const { return mStrings.size(); }
+		
+		
+		/* count followed by each length and its characters */
+		void write (const std::string& file) const
+		{
+			std::ofstream stream (file.c_str(), std::ios::out | std::ios::binary);
+			
+			uint32_t count = mStrings.size();
+			stream.write (reinterpret_cast<const char*> (&count), sizeof (count));
+			
+			for (size_t i = 0; i < mStrings.size(); i++)
+			{
+				uint32_t length = mStrings[i].size();
+				stream.write (reinterpret_cast<const char*> (&length), sizeof (length));
+				stream.write (mStrings[i].data(), length);
+			}
+			
+			if (!stream)
+				throw std::runtime_error ("Failed to write '" + file + "'");
+		}
+		
+		
+	private:
+		std::mutex mMutex;
+		std::unordered_map<std::string, uint32_t> mIndex;
+		std::vector<std::string> mStrings;
+	};
+	
+	
+	
+	/* bytes of memory held by the files in flight. a file larger than
+	 * the whole budget waits until it is the only one */
+	class MemoryBudget
+	{
+	public:
+		explicit MemoryBudget (size_t budget) : mBudget(budget), mUsed(0) {}
+		
+		
+		size_t acquire (size_t bytes)
+		{
+			bytes = std::min (bytes, mBudget);
+			
+			std::unique_lock<std::mutex> lock (mMutex);
+			mReleased.wait (lock, [&] { return mUsed + bytes <= mBudget; });
+			
+			mUsed += bytes;
+			return bytes;
+		}
+		
+		
+		void release (size_t bytes)
+		{
+			std::lock_guard<std::mutex> lock (mMutex);
+			mUsed -= bytes;
+			mReleased.notify_all ();
+		}
+		
+		
+	private:
+		size_t mBudget;
+		size_t mUsed;
+		
+		std::mutex mMutex;
+		std::condition_variable mReleased;
+	};
+	
+	
+	
+	/* what a single file produced */
+	struct FileStats
+	{
+		std::string file;
+		size_t bytes;
+		size_t geometries;
+		size_t primitives;
+		size_t vertices;
+		size_t output;
+		double seconds;
+		std::string error;
+		
+		FileStats () : bytes(0), geometries(0), primitives(0), vertices(0), output(0), seconds(0) {}
+	};
+	
+	
+	
+	/* the parsed tree and decoded arrays take a few times the text size */
+	static const size_t MEMORY_PER_BYTE = 4;
+	
+	static const uint32_t BLOB_VERSION = 1;
+	static const uint32_t BLOB_NORMALS = 1;
+	static const uint32_t BLOB_TEXCOORDS = 2;
+	
+	
+	
+	static bool endsWith (const std::string& text, const std::string& suffix)
+	{
+		if (text.size() < suffix.size())
+			return false;
+		
+		for (size_t i = 0; i < suffix.size(); i++)
+		{
+			if (tolower (text[text.size() - suffix.size() + i]) != suffix[i])
+				return false;
+		}
+		
+		return true;
+	}
+	
+	
+	static bool isDirectory (const std::string& path)
+	{
+		struct stat info;
+		return stat (path.c_str(), &info) == 0 && (info.st_mode & S_IFDIR);
+	}
+	
+	
+	static size_t getFileSize (const std::string& path)
+	{
+		struct stat info;
+		return stat (path.c_str(), &info) == 0 ? info.st_size : 0;
+	}
+	
+	
+	
+	/* every .dae file below a directory */
+	static void listDirectory (const std::string& path, std::vector<std::string>& files)
+	{
+		std::vector<std::string> entries;
+		
+#ifdef _WIN32
+		WIN32_FIND_DATAA data;
+		HANDLE find = FindFirstFileA ((path + "\\*").c_str(), &data);
+		
+		if (find != INVALID_HANDLE_VALUE)
+		{
+			do entries.push_back (data.cFileName);
+			while (FindNextFileA (find, &data));
+			
+			FindClose (find);
+		}
+#else
+		DIR* dir = opendir (path.c_str());
+		
+		if (dir)
+		{
+			while (dirent* entry = readdir (dir))
+				entries.push_back (entry->d_name);
+			
+			closedir (dir);
+		}
+#endif
+		
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (entries[i] == "." || entries[i] == "..")
+				continue;
+			
+			std::string child = path + "/" + entries[i];
+			
+			if (isDirectory (child))
+				listDirectory (child, files);
+			
+			else if (endsWith (entries[i], ".dae"))
+				files.push_back (child);
+		}
+	}
+	
+	
+	/* one file per line */
+	static void readList (const std::string& list, std::vector<std::string>& files)
+	{
+		std::ifstream stream (list.c_str());
+		
+		if (!stream)
+			throw std::runtime_error ("Failed to open file list '" + list + "'");
+		
+		std::string line;
+		
+		while (std::getline (stream, line))
+		{
+			if (!line.empty() && line[line.size() - 1] == '\r')
+				line.erase (line.size() - 1);
+			
+			if (!line.empty())
+				files.push_back (line);
+		}
+	}
+	
+	
+	
+	/* blob name from the position in the file list and the input path.
+	 * paths that flatten to the same name still get distinct blobs */
+	static std::string getBlobName (const std::string& file, size_t index)
+	{
+		std::string name = file;
+		
+		while (name.compare (0, 2, "./") == 0)
+			name.erase (0, 2);
+		
+		for (size_t i = 0; i < name.size(); i++)
+		{
+			if (name[i] == '/' || name[i] == '\\' || name[i] == ':')
+				name[i] = '_';
+		}
+		
+		char prefix[32];
+		std::snprintf (prefix, sizeof (prefix), "%06zu-", index);
+		
+		return prefix + name + ".mesh";
+	}
+	
+	
+	
+	/* flatten every primitive into unindexed interleaved vertices. the
+	 * blob holds a header and per primitive its geometry id, material
+	 * symbol, vertex count, layout flags and the vertex floats */
+	static void convert (const std::string& file, const std::string& blob, StringInterner& strings, FileStats& stats)
+	{
+		Document document (file);
+		document.open ();
+		
+		std::ofstream stream (blob.c_str(), std::ios::out | std::ios::binary);
+		
+		if (!stream)
+			throw std::runtime_error ("Failed to write '" + blob + "'");
+		
+		
+		const GeometryList& geometries = document.getGeometries ();
+		std::vector<Primitive*> primitives;
+		
+		for (size_t g = 0; g < geometries.size(); g++)
+			primitives.insert (primitives.end(), geometries[g]->getPrimitives().begin(), geometries[g]->getPrimitives().end());
+		
+		
+		uint32_t header[3] = { 0, BLOB_VERSION, uint32_t (primitives.size()) };
+		std::memcpy (header, "CMSH", 4);
+		stream.write (reinterpret_cast<const char*> (header), sizeof (header));
+		
+		std::vector<float> vertices;
+		
+		for (size_t g = 0; g < geometries.size(); g++)
+		{
+			const std::vector<Primitive*>& list = geometries[g]->getPrimitives ();
+			
+			for (size_t p = 0; p < list.size(); p++)
+			{
+				const Primitive* primitive = list[p];
+				
+				bool normals = primitive->hasNormals ();
+				bool texcoords = primitive->hasTexCoords ();
+				int count = primitive->getIndexCount ();
+				
+				uint32_t mesh[4];
+				mesh[0] = strings.intern (geometries[g]->getID());
+				mesh[1] = strings.intern (primitive->getMaterial());
+				mesh[2] = count;
+				mesh[3] = (normals ? BLOB_NORMALS : 0) | (texcoords ? BLOB_TEXCOORDS : 0);
+				stream.write (reinterpret_cast<const char*> (mesh), sizeof (mesh));
+				
+				
+				vertices.clear ();
+				
+				for (int i = 0; i < count; i++)
+				{
+					Vector vertex = primitive->getVertex (i);
+					vertices.insert (vertices.end(), &vertex.x, &vertex.x + 3);
+					
+					if (normals)
+					{
+						Vector normal = primitive->getNormal (i);
+						vertices.insert (vertices.end(), &normal.x, &normal.x + 3);
+					}
+					
+					if (texcoords)
+					{
+						TexCoord texcoord = primitive->getTexCoord (i);
+						vertices.push_back (texcoord.u);
+						vertices.push_back (texcoord.v);
+					}
+				}
+				
+				if (!vertices.empty())
+					stream.write (reinterpret_cast<const char*> (&vertices[0]), vertices.size() * sizeof (float));
+				
+				stats.vertices += count;
+			}
+			
+			stats.primitives += list.size();
+		}
+		
+		stats.geometries = geometries.size();
+		stats.output = stream.tellp ();
+		
+		if (!stream)
+			throw std::runtime_error ("Failed to write '" + blob + "'");
+	}
+	
+	
+	
+	static void usage ()
+	{
+		std::fprintf (stderr,
+			"usage: collada-batch [-j threads] [-m megabytes] [-o directory]\n"
+			"                     [-l list] [file or directory]...\n"
+			"\n"
+			"  -j  parser threads, zero uses every core (default 0)\n"
+			"  -m  memory budget for the files in flight (default 1024)\n"
+			"  -o  directory for the mesh blobs and strings.bin (default .)\n"
+			"  -l  read file names from a list, one per line\n");
+	}
+
+}
+
+
+
+int main (int argc, char** argv)
+{
+	unsigned int threads = 0;
+	size_t budget = 1024;
+	std::string output = ".";
+	std::vector<std::string> files;
+	
+	
+	try
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			bool value = i + 1 < argc;
+			
+			if      (arg == "-j" && value) threads = std::atoi (argv[++i]);
+			else if (arg == "-m" && value) budget  = std::strtoul (argv[++i], 0, 10);
+			else if (arg == "-o" && value) output  = argv[++i];
+			else if (arg == "-l" && value) readList (argv[++i], files);
+			
+			else if (arg[0] == '-')
+			{
+				usage ();
+				return 2;
+			}
+			
+			else if (isDirectory (arg)) listDirectory (arg, files);
+			else files.push_back (arg);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf (stderr, "collada-batch: %s\n", e.what());
+		return 2;
+	}
+	
+	if (files.empty())
+	{
+		usage ();
+		return 2;
+	}
+	
+	
+	/* largest files first so a big one does not finish last */
+	std::vector<FileStats> stats (files.size());
+	std::vector<size_t> order (files.size());
+	
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		stats[i].file = files[i];
+		stats[i].bytes = getFileSize (files[i]);
+		order[i] = i;
+	}
+	
+	std::sort (order.begin(), order.end(), [&] (size_t a, size_t b) { return stats[a].bytes > stats[b].bytes; });
+	
+	
+	StringInterner strings;
+	MemoryBudget memory (std::max<size_t> (budget, 1) << 20);
+	std::mutex printing;
+	
+	ThreadPool pool (threads);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	
+	pool.parallelFor (files.size(), 1, [&] (size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			FileStats& file = stats[order[i]];
+			size_t held = memory.acquire (file.bytes * MEMORY_PER_BYTE);
+			
+			std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+			std::string blob = output + "/" + getBlobName (file.file, order[i]);
+			
+			try
+			{
+				convert (file.file, blob, strings, file);
+			}
+			catch (const std::exception& e)
+			{
+				/* never leave a partial blob behind */
+				std::remove (blob.c_str());
+				file.error = e.what();
+			}
+			
+			memory.release (held);
+			file.seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - started).count();
+			
+			
+			std::lock_guard<std::mutex> lock (printing);
+			
+			if (file.error.empty())
+				std::printf ("%s: %zu bytes, %zu geometries, %zu primitives, %zu vertices, %zu bytes out, %.3fs\n",
+					file.file.c_str(), file.bytes, file.geometries, file.primitives, file.vertices, file.output, file.seconds);
+			else
+				std::printf ("%s: failed: %s\n", file.file.c_str(), file.error.c_str());
+			
+			std::fflush (stdout);
+		}
+	});
+	
+	
+	size_t failed = 0, bytes = 0;
+	
+	for (size_t i = 0; i < stats.size(); i++)
+	{
+		failed += !stats[i].error.empty();
+		bytes += stats[i].bytes;
+	}
+	
+	try
+	{
+		strings.write (output + "/strings.bin");
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf (stderr, "collada-batch: %s\n", e.what());
+		return 1;
+	}
+	
+	double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+	
+	std::printf ("%zu files, %zu failed, %zu bytes in %.3fs on %u threads, %zu strings\n",
+		files.size(), failed, bytes, seconds, pool.getThreadCount(), strings.getCount());
+	
+	return failed ? 1 : 0;
+}